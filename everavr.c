@@ -13,7 +13,7 @@
  *  Xtal    |9 B6   GND 20|                    - (20) (19) FS (conn. to Vcc)
  *  Xtal    |10 B7   B5 19| SCK  Prg             (22) (21)
  *  LCD C/D |11 D5   B4 18| MISO Prg
- *  LCD D6  |12 D6   B3 17| MOSI Prd
+ *  LCD D6  |12 D6   B3 17| MOSI Prg, Ser. RTS
  *  LCD D7  |13 D7   B2 16| LCD \RD
  *  LCD \CS |14 B0   B1 15| LCD \WR
  *          +-------------+
@@ -32,7 +32,7 @@
  *         +------+------+------+------+------+------+------+------+
  *  PORTC  |      |      |  D5  |  D4  |  D3  |  D2  |  D1  |  D0  |
  *         +------+------+------+------+------+------+------+------+
- *  PORTB  |      |      |      |      |      | \RD  | \WR  | \CS  |
+ *  PORTB  |      |      |      |      | RTS  | \RD  | \WR  | \CS  |
  *         +------+------+------+------+------+------+------+------+
  *
  * FUSE bytes:
@@ -43,14 +43,217 @@
 
 #include <avr/io.h>
 #include <avr/interrupt.h>
+#include <avr/pgmspace.h>
 
 #include "lcd_hardware.h"
+#include "protocol.h"
+#include "telemetry.h"
+#include "gfx.h"
+#include "scroll.h"
+#include "page.h"
+#include "term.h"
 #include <usbdrv.h>
 
-static void eat_char(uint8_t c); // used by USB code...
+static uint8_t eat_buffer(const uint8_t *buf,uint8_t len);
+static uint16_t readback_left;    // bytes of ^R still to go, see Readback
+
+/* ---------------------- Input buffer ---------------------- */
+
+/* All protocol input, from the USART RX interrupt and from
+   usbFunctionWrite(), is queued here and eaten by the main loop, so
+   nothing gets lost while eat_buffer() is busy with the LCD (e.g. the
+   8k clear in lcd_hardware_init()). Single consumer (main loop), the
+   two producers are serialized by masking RXCIE0 on the USB side. Every
+   slot has a bit for where its byte came from, input_drain() hands
+   eat_buffer() runs of one source and says which in eat_usb, so an
+   answer (^R) goes back the way its command came in and only a ^B
+   that came over the UART confirms a ^U rate. */
+
+#define INPUT_SIZE  128  /* power of two, <= 256 */
+#define INPUT_MASK  (INPUT_SIZE-1)
+#define INPUT_BATCH 32   /* bytes to eat between two usbPoll() */
+
+static volatile uint8_t input_buf[INPUT_SIZE];
+static volatile uint8_t input_head; /* written by producers */
+static volatile uint8_t input_tail; /* written by main loop */
+static volatile uint8_t input_src[INPUT_SIZE/8]; /* bit set: from USB */
+static uint8_t eat_usb; /* the bytes being eaten came from USB */
+
+static inline uint8_t
+input_free(){
+	return INPUT_MASK - ((input_head - input_tail) & INPUT_MASK);
+}
+
+/* queue one byte, caller makes sure there is space */
+static inline void
+input_put(uint8_t c,uint8_t usb){
+	uint8_t h = input_head, m = 1 << (h & 7);
+	input_buf[h] = c;
+	if(usb)
+		input_src[h >> 3] |= m;
+	else
+		input_src[h >> 3] &= ~m;
+	input_head = (h+1) & INPUT_MASK;
+}
+
+static inline uint8_t
+input_from_usb(uint8_t t){
+	return input_src[t >> 3] & (1 << (t & 7));
+}
+
+/* how many of the k bytes from slot t on came from where the first did,
+   which goes to eat_usb */
+static uint8_t
+input_run(uint8_t t,uint8_t k){
+	uint8_t usb = input_from_usb(t), i = 1;
+	while(i < k && !input_from_usb(t+i) == !usb)
+		i++;
+	eat_usb = !!usb;
+	return i;
+}
+
+/* eat up to n queued bytes, return number of bytes eaten; stops at a
+   ^R, nothing is eaten while a readback is pending. The bytes up to the
+   head, the end of the buffer or the other source go to eat_buffer()
+   in one piece, their slots are free again afterwards. */
+static uint8_t
+input_drain(uint8_t n){
+	uint8_t t = input_tail, i = 0, k;
+	while(i < n && t != input_head && !readback_left){
+		k = (input_head - t) & INPUT_MASK;
+		if(k > INPUT_SIZE - t)
+			k = INPUT_SIZE - t;
+		if(k > n - i)
+			k = n - i;
+		k = input_run(t,k);
+		/* producers don't touch the slots between tail and head */
+		k = eat_buffer((const uint8_t *)input_buf + t,k);
+		input_tail = t = (t+k) & INPUT_MASK;
+		i += k;
+	}
+	return i;
+}
+
+/* ---------------------- Output buffer --------------------- */
+
+/* Serial output (^B, ^D, ^R) is queued here and sent by the UDRE
+   interrupt, a readback goes out at line rate without the main loop
+   waiting for UDRE0. Single producer (main loop). */
+
+#define TX_SIZE  64  /* power of two, <= 256 */
+#define TX_MASK  (TX_SIZE-1)
+
+static volatile uint8_t tx_buf[TX_SIZE];
+static volatile uint8_t tx_head; /* written by main loop */
+static volatile uint8_t tx_tail; /* written by UDRE ISR */
+
+static inline uint8_t
+tx_free(){
+	return TX_MASK - ((tx_head - tx_tail) & TX_MASK);
+}
+
+/* queue one byte, caller makes sure there is space */
+static inline void
+tx_put(uint8_t c){
+	uint8_t h = tx_head;
+	tx_buf[h] = c;
+	tx_head = (h+1) & TX_MASK;
+	tm_count(tx,1);
+	cli(); /* both USART ISRs modify UCSR0B */
+	UCSR0B |= _BV(UDRIE0);
+	sei();
+}
+
+/* as USART_RX_vect below: UDRIE0 is masked while interrupts are on */
+ISR(USART_UDRE_vect){
+	uint8_t t = tx_tail;
+	UCSR0B &= ~_BV(UDRIE0);
+	sei();
+	UDR0 = tx_buf[t];
+	tx_tail = t = (t+1) & TX_MASK;
+	cli();
+	if(t != tx_head)
+		UCSR0B |= _BV(UDRIE0);
+}
+
+/* ---------------------- Readback -------------------------- */
+
+/* ^R leaves the controller in auto read mode with readback_left bytes
+   to go. They are pulled out by readback_pump() into the output buffer,
+   or by usbFunctionRead() for GET_REPORT if the ^R came in over USB.
+   The LCD is ours meanwhile, input_drain() doesn't eat anything.
+   ^T uses the same path, from readback_ram instead of the LCD. */
+
+static uint8_t readback_usb; /* answer over USB, not serial */
+static const uint8_t *readback_ram; /* not from the LCD, but from here */
+
+/* read up to len bytes of the pending range into buf */
+static uint8_t
+readback_get(uint8_t *buf,uint8_t len){
+	uint8_t i;
+	for(i=0;i<len && readback_left;i++){
+		if(readback_ram)
+			buf[i] = *readback_ram++;
+		else
+			lcd_auto_read(buf+i);
+		if(--readback_left == 0 && !readback_ram)
+			lcd_auto_reset();
+	}
+	return i;
+}
+
+/* serial: move as much as fits into the output buffer */
+static void
+readback_pump(){
+	uint8_t c = 0;
+	while(readback_left && tx_free()){
+		readback_get(&c,1);
+		tx_put(c);
+	}
+}
+
+static void
+readback_cancel(){
+	if(!readback_left)
+		return;
+	readback_left = 0;
+	if(!readback_ram)
+		lcd_auto_reset();
+	tm_count(readback_cancel,1);
+}
+
+/* ---------------------- Flow control ---------------------- */
+
+/* Both senders are stopped when fewer than INPUT_STOP bytes are free,
+   and started again at INPUT_GO: the UART with RTS on PB3 (to the
+   host's CTS, high = stop), USB by NAKing everything with V-USB's
+   usbDisableAllRequests(), which may only be used in usbFunctionWrite(). */
+
+#define INPUT_STOP  16   /* a USB packet and a few UART bytes still fit */
+#define INPUT_GO    (INPUT_SIZE/2)
+
+#define PORTB_RTS   _BV(3)
+
+static uint8_t usb_stopped;
+
+/* main loop: start the senders again once we've caught up. A pending
+   USB readback needs the host's GET_REPORTs even if input is stuck. */
+static void
+flow_go(){
+	uint8_t go = input_free() >= INPUT_GO;
+	if(go)
+		PORTB &= ~PORTB_RTS;
+	if(usb_stopped && (go || (readback_left && readback_usb))){
+		usb_stopped = 0;
+		usbEnableAllRequests();
+	}
+}
 
 /* ---------------------- USB ------------------------------- */
 
+/* bytes still to come in the current SET_REPORT or USB_RQ_STREAM */
+static usbMsgLen_t usb_write_left;
+
 PROGMEM char usbHidReportDescriptor[22] = {    /* USB report descriptor */
     0x06, 0x00, 0xff,              // USAGE_PAGE (Generic Desktop)
     0x09, 0x01,                    // USAGE (Vendor Usage 1)
@@ -69,7 +272,7 @@ PROGMEM char usbHidReportDescriptor[22] = {    /* USB report descriptor */
  */
 uchar
 usbFunctionRead(uchar *data, uchar len){
-	return 1;
+	return readback_get(data,len); /* short: done */
 }
 
 /* usbFunctionWrite() is called when the host sends a chunk of data to the
@@ -77,11 +280,48 @@ usbFunctionRead(uchar *data, uchar len){
  */
 uchar
 usbFunctionWrite(uchar *data, uchar len){
- 	int i;
+	uchar i;
+
+	if(len > usb_write_left)
+		len = usb_write_left;
+	if(readback_usb)
+		readback_cancel(); /* not fetched, see protocol.h */
+
+	/* buffer full, only if the host ignored a cancelled readback: eat
+	   right here. The driver NAKs the next packet until we return. */
+	while(input_free() < len){
+		if(readback_left && !readback_usb)
+			readback_pump(); /* serial ^R in progress */
+		else if(readback_left)
+			readback_cancel(); /* a USB one, queued before */
+		else
+			input_drain(len);
+	}
 
+	cli(); /* keep the USART ISRs off input_head and UCSR0B */
+	UCSR0B &= ~_BV(RXCIE0);
+	sei();
 	for(i=0;i<len;i++)
-		eat_char(data[i]);
-	return 1;
+		input_put(data[i],1);
+	tm_count(rx_usb,len);
+	if(input_free() < INPUT_STOP){
+		usbDisableAllRequests(); /* until flow_go() */
+		usb_stopped = 1;
+		tm_count(usb_stops,1);
+	}
+	cli();
+	UCSR0B |= _BV(RXCIE0);
+	sei();
+	usb_write_left -= len;
+	return usb_write_left == 0;
+}
+
+/* GET_REPORT/USB_RQ_READBACK: the ^R may still be queued, eat up to it */
+static usbMsgLen_t
+usb_readback_setup(){
+	while(!readback_left && input_drain(INPUT_BATCH))
+		;
+	return readback_left && readback_usb ? USB_NO_MSG : 0;
 }
 
 usbMsgLen_t
@@ -95,34 +335,94 @@ usbFunctionSetup(uchar data[8]){
 			/* since we have only one report type, we can ignore
 			   the report-ID */
 			/* use usbFunctionRead() to obtain data */
-			return USB_NO_MSG;
+			return usb_readback_setup();
 		} else if(rq->bRequest == USBRQ_HID_SET_REPORT){
 			/* since we have only one report type, we can
 			   ignore the report-ID */
 			/* use usbFunctionWrite() to receive data from host */
+			usb_write_left = rq->wLength.word;
 			return USB_NO_MSG;
 		}
-	}else{
-		/* ignore vendor type requests, we don't use any */
+	}else if((rq->bmRequestType & USBRQ_TYPE_MASK) == USBRQ_TYPE_VENDOR){
+		if(rq->bRequest == USB_RQ_STREAM){
+			/* protocol stream, one frame per transfer */
+			usb_write_left = rq->wLength.word;
+			return USB_NO_MSG;
+		}
+		if(rq->bRequest == USB_RQ_READBACK)
+			return usb_readback_setup();
 	}
 	return 0;
 }
 
 /* -------- Serial Port ------------- */
-inline int
-get_char(unsigned char *c){
-	if(!(UCSR0A & _BV(RXC0))){
-		return -1; // nothing in input buffer!
-	}
-	*c=UDR0; /* read from serial port */
-	return 0;
+
+/* ^U: the switch waits until the output buffer is empty and the last
+   byte is through the shift register, then the new divisor is on trial
+   until a ^B comes in at it (see eat_char()). Timer1 ticks, F_CPU/256. */
+#define BAUD_TIMEOUT ((uint16_t)(F_CPU / 256 / 2))       /* 0.5 s */
+#define BAUD_DRAIN(ubrr) (((ubrr) + 1) * 5 / 8 + 1)     /* 2 chars */
+
+static uint8_t baud_next;           /* divisor to switch to, 0: none */
+static volatile uint8_t baud_trial; /* no ^B at the new rate yet */
+static uint16_t baud_t0;
+
+static void
+baud_default(){
+	UBRR0 = BAUD_DEFAULT;
+	baud_trial = 0;
+}
+
+/* main loop */
+static void
+baud_poll(){
+	uint16_t t = TCNT1;
+	if(baud_next){
+		if(tx_head != tx_tail) /* count from the last byte on */
+			baud_t0 = t;
+		else if((uint16_t)(t - baud_t0) > BAUD_DRAIN(UBRR0)){
+			cli(); /* the RX interrupt looks at both */
+			UBRR0 = baud_next;
+			baud_trial = baud_next != BAUD_DEFAULT;
+			sei();
+			baud_next = 0;
+			baud_t0 = t;
+		}
+	} else if(baud_trial && (uint16_t)(t - baud_t0) > BAUD_TIMEOUT)
+		baud_default();
+}
+
+/* The V-USB interrupt must not be held off for long, so interrupts are
+   enabled again as soon as the byte is out of UDR0. RXCIE0 stays masked
+   until we're done, a second byte in the USART FIFO would re-enter. */
+ISR(USART_RX_vect){
+	uint8_t st = UCSR0A; /* DOR0 is valid until UDR0 is read */
+	uint8_t c = UDR0;
+	UCSR0B &= ~_BV(RXCIE0);
+	sei();
+	tm_count(uart_overrun,!!(st & _BV(DOR0)));
+	if((st & _BV(FE0)) && UBRR0 != BAUD_DEFAULT){
+		baud_default(); /* a break, or the host is at BAUD_RESET */
+	} else if(input_free()){
+		input_put(c,0);
+		tm_count(rx_uart,1);
+		if(input_free() < INPUT_STOP && !(PORTB & PORTB_RTS)){
+			PORTB |= PORTB_RTS; /* until flow_go() */
+			tm_count(uart_stops,1);
+		}
+	} else /* overrun, the byte is lost */
+		tm_count(uart_lost,1);
+	cli();
+	UCSR0B |= _BV(RXCIE0);
 }
 
 inline int
 put_char(unsigned char c){
-	if(!(UCSR0A & _BV(UDRE0)))
+	if(!tx_free()){
+		tm_count(tx_lost,1);
 		return -1; // no space
-	UDR0 = c;
+	}
+	tx_put(c);
 	return 0;
 }
 
@@ -181,34 +481,6 @@ get_hex(uint8_t *val){
 }
 #endif
 
-/*
- * Protocol on serial port:
- *    <0x20 .. 0xff> -> write char - 0x20 to LCD memory
- * 			(convert ASCII to LCD charset)
- *    ^A/0x01 byte   -> write byte to LCD memory, literally
- *    ^B/0x02 byte   -> echo byte back to serial port
- *    ^C/0x03 lo hi  -> set address pointer (for mem read/write) to addr
- *    ^D/0x04        -> write status byte to serial port
- *    ^E/0x05        -> execute lcd hardware init
- *    ^F/0x06 byte   -> set graphic/text combination mode (see hardware.h)
- *    ^G/0x07 byte   -> set display mode (text, cursor, blink, gfx. on/off)
- *    ^H/0x08 byte   -> set cursor width (0..7 -> 1..8 lines)
- *    ^I/0x09 count bytes... -> bulk transfer count bytes (count=0: 256 byte)
- *    ^J/0x0a x y    -> set cursor to x,y
- */
-
-#define CHAR_NOP     0x00
-#define CHAR_WRITE   0x01	// ^A
-#define CHAR_ECHO    0x02	// ^B
-#define CHAR_ADDR    0x03	// ^C
-#define CHAR_STATUS  0x04	// ^D
-#define CHAR_RESET   0x05	// ^E
-#define CHAR_MODE    0x06	// ^F
-#define CHAR_DISP    0x07	// ^G
-#define CHAR_CURSOR  0x08	// ^H
-#define CHAR_BULK    0x09       // ^I
-#define CHAR_POS_CURSOR 0x10    // ^J
-
 enum serport_state {
 	serport_idle,
 	serport_echo,
@@ -221,10 +493,109 @@ enum serport_state {
 	serport_bulk_count,
 	serport_bulk_data,
 	serport_pos_cursor_x,
-	serport_pos_cursor_y
+	serport_pos_cursor_y,
+	serport_lbulk_lo,
+	serport_lbulk_hi,
+	serport_lbulk_data,
+	serport_pack_op,
+	serport_pack_literal,
+	serport_pack_repeat,
+	serport_pack_zero,
+	serport_read_lo,
+	serport_read_hi,
+	serport_read_nlo,
+	serport_read_nhi,
+	serport_telemetry,
+	serport_text_x,
+	serport_text_y,
+	serport_text_flags,
+	serport_text_len,
+	serport_text_chars,
+	serport_tile_slot,
+	serport_tile_count,
+	serport_draw_op,
+	serport_draw_args,
+	serport_scroll_op,
+	serport_scroll_data,
+	serport_page,
+	serport_terminal,
+	serport_baud,
+	serport_print	/* idle, in an auto write session of text */
 };
 uint8_t global_serport_state;
 uint8_t global_serport_data; /* memorize stuff for serial protocol */
+uint16_t global_serport_count; /* bytes left in ^K bulk transfer */
+
+/* state after a control char in serport_idle; the commands that do
+   something right away are in the switch in eat_char() */
+static PROGMEM const uint8_t serport_cmd[0x20] = {
+	[CHAR_WRITE]      = serport_write_data,
+	[CHAR_ECHO]       = serport_echo,
+	[CHAR_ADDR]       = serport_set_addr_lo,
+	[CHAR_MODE]       = serport_mode,
+	[CHAR_DISP]       = serport_disp,
+	[CHAR_CURSOR]     = serport_cursor,
+	[CHAR_BULK]       = serport_bulk_count,
+	[CHAR_LBULK]      = serport_lbulk_lo,
+	[CHAR_PACKED]     = serport_pack_op,
+	[CHAR_TEXT]       = serport_text_x,
+	[CHAR_TILES]      = serport_tile_slot,
+	[CHAR_POS_CURSOR] = serport_pos_cursor_x,
+	[CHAR_READ]       = serport_read_lo,
+	[CHAR_TELEMETRY]  = serport_telemetry,
+	[CHAR_BAUD]       = serport_baud,
+	[CHAR_DRAW]       = serport_draw_op,
+	[CHAR_SCROLL]     = serport_scroll_op,
+	[CHAR_PAGE]       = serport_page,
+	[CHAR_TERMINAL]   = serport_terminal,
+};
+
+/* arguments of the commands that run once they are complete */
+static union {
+	struct {	/* ^N */
+		uint8_t x, y, flags, len, n;
+		uint8_t buf[GFX_TEXT_MAX];
+	} text;
+	struct {	/* ^V */
+		uint8_t op, n;
+		uint8_t a[4];
+	} draw;
+	struct {	/* ^W */
+		uint8_t op, n;
+		uint8_t line[LCD_GRAPHIC_COLS];
+	} scroll;
+} arg;
+
+static void
+draw_run(){
+	uint8_t mode = arg.draw.op & DRAW_MODE, *a = arg.draw.a;
+	switch(arg.draw.op & DRAW_OP){
+	case DRAW_PLOT:
+		gfx_plot(a[0],a[1],mode);
+		break;
+	case DRAW_HLINE:
+		gfx_hline(a[0],a[1],a[2],mode);
+		break;
+	case DRAW_VLINE:
+		gfx_vline(a[0],a[1],a[2],mode);
+		break;
+	case DRAW_LINE:
+		gfx_line(a[0],a[1],a[2],a[3],mode);
+		break;
+	case DRAW_RECT:
+		gfx_rect(a[0],a[1],a[2],a[3],mode);
+		break;
+	case DRAW_FILL:
+		gfx_fill(a[0],a[1],a[2],a[3],mode);
+		break;
+	}
+}
+
+/* sim/bench.c counts state machine rounds (eat_char() and runs of
+   eat_buffer()) with this */
+#ifndef EAT_COUNT
+#define EAT_COUNT(n)
+#endif
 
 /* state machine for our serial protocol. Eating one character at a time */
 static void
@@ -235,9 +606,18 @@ eat_char(uint8_t c){
 
 	case serport_echo:
 		serport_state = serport_idle;
+		if(!eat_usb && !baud_next) /* this ^B came over the UART */
+			baud_trial = 0; /* the host is at the new rate */
 		put_char(c);
 		break;
 
+	case serport_baud:
+		if(c){
+			baud_next = c;
+			baud_t0 = TCNT1;
+		}
+		goto become_idle;
+
 	case serport_write_data:
 		lcd_command_1(CMD_DATA_WRITE_INC,c);
 		goto become_idle;
@@ -248,11 +628,14 @@ eat_char(uint8_t c){
 		break;
 
 	case serport_set_addr_hi:
-		lcd_command_2(CMD_ADDRESS_POINTER,serport_data,c);
+		lcd_command_long(CMD_ADDRESS_POINTER,
+			page_addr(serport_data | (c << 8)));
 		goto become_idle;
 
 	case serport_mode:
 		c &= CMD_MODE_MASK;
+		if(c & CMD_MODE_EXT_CG)
+			lcd_cgram_prepare();
 		c |= CMD_SET_MODE;
 		lcd_command(c);
 		goto become_idle;
@@ -276,13 +659,198 @@ eat_char(uint8_t c){
 
 	case serport_bulk_data:
 		serport_data--;
-		lcd_data(c);
+		lcd_auto_write(c);
 		if(serport_data == 0){
-			lcd_command(CMD_AUTO_RESET);
+			lcd_auto_reset();
 			goto become_idle;
 		}
 		break; /* stay in serport_bulk_data state */
 
+	case serport_lbulk_lo:
+		serport_data = c;
+		serport_state = serport_lbulk_hi;
+		break;
+
+	case serport_lbulk_hi:
+		global_serport_count = serport_data | (c << 8);
+		if(global_serport_count == 0)
+			goto become_idle;
+		lcd_command(CMD_AUTO_WRITE);
+		serport_state = serport_lbulk_data;
+		break;
+
+	case serport_lbulk_data:
+		lcd_auto_write(c);
+		if(--global_serport_count == 0){
+			lcd_auto_reset();
+			goto become_idle;
+		}
+		break; /* stay in serport_lbulk_data state */
+
+	/* ^L packed data, see protocol.h; serport_data counts literals,
+	   repeats, or holds the upper bits of a zero run */
+	case serport_pack_op:
+		if(c == PACK_END){
+			lcd_auto_reset();
+			goto become_idle;
+		}
+		if(c < PACK_REPEAT){
+			serport_data = c;
+			serport_state = serport_pack_literal;
+		} else if(c < PACK_ZERO){
+			serport_data = (c & 0x3f) + 2;
+			serport_state = serport_pack_repeat;
+		} else {
+			serport_data = c & 0x3f;
+			serport_state = serport_pack_zero;
+		}
+		break;
+
+	case serport_pack_literal:
+		lcd_auto_write(c);
+		if(--serport_data == 0)
+			serport_state = serport_pack_op;
+		break;
+
+	case serport_pack_repeat:
+		do
+			lcd_auto_write(c);
+		while(--serport_data);
+		serport_state = serport_pack_op;
+		break;
+
+	case serport_pack_zero: {
+		register uint16_t n = ((serport_data << 8) | c) + 1;
+		do
+			lcd_auto_write(0);
+		while(--n);
+		serport_state = serport_pack_op;
+		break;
+	}
+
+	case serport_read_lo:
+		serport_data = c;
+		serport_state = serport_read_hi;
+		break;
+
+	case serport_read_hi:
+		lcd_command_long(CMD_ADDRESS_POINTER,
+			page_addr(serport_data | (c << 8)));
+		serport_state = serport_read_nlo;
+		break;
+
+	case serport_read_nlo:
+		serport_data = c;
+		serport_state = serport_read_nhi;
+		break;
+
+	case serport_read_nhi: /* answer where the ^R came from */
+		readback_left = serport_data | (c << 8);
+		readback_usb = eat_usb;
+		readback_ram = 0;
+		if(readback_left)
+			lcd_command(CMD_AUTO_READ);
+		goto become_idle;
+
+	case serport_telemetry:
+#if TELEMETRY
+		if(c & TELEMETRY_CLEAR){
+			tm_clear();
+			goto become_idle;
+		}
+		readback_left = sizeof(tm);
+		readback_usb = eat_usb;
+		readback_ram = (const uint8_t *)&tm;
+#endif
+		goto become_idle;
+
+	case serport_text_x:
+		arg.text.x = c;
+		serport_state = serport_text_y;
+		break;
+
+	case serport_text_y:
+		arg.text.y = c;
+		serport_state = serport_text_flags;
+		break;
+
+	case serport_text_flags:
+		arg.text.flags = c;
+		serport_state = serport_text_len;
+		break;
+
+	case serport_text_len:
+		arg.text.len = c;
+		arg.text.n = 0;
+		if(!c)
+			goto become_idle;
+		serport_state = serport_text_chars;
+		break;
+
+	case serport_text_chars:
+		if(arg.text.n < GFX_TEXT_MAX)
+			arg.text.buf[arg.text.n] = c;
+		if(++arg.text.n < arg.text.len)
+			break;
+		gfx_text(arg.text.x,arg.text.y,arg.text.flags,arg.text.buf,
+			arg.text.n < GFX_TEXT_MAX ? arg.text.n : GFX_TEXT_MAX);
+		goto become_idle;
+
+	case serport_tile_slot:
+		serport_data = c;
+		serport_state = serport_tile_count;
+		break;
+
+	case serport_tile_count: /* the rest is a ^K into CG RAM */
+		lcd_cgram_prepare();
+		lcd_command_long(CMD_ADDRESS_POINTER,
+			LCD_CGRAM_BASE + serport_data * TILE_SIZE);
+		global_serport_count = (c ? c : 256) * TILE_SIZE;
+		lcd_command(CMD_AUTO_WRITE);
+		serport_state = serport_lbulk_data;
+		break;
+
+	case serport_draw_op:
+		arg.draw.op = c;
+		arg.draw.n = 0;
+		serport_state = serport_draw_args;
+		break;
+
+	case serport_draw_args:
+		arg.draw.a[arg.draw.n++] = c;
+		if(arg.draw.n < DRAW_NARGS(arg.draw.op & DRAW_OP))
+			break;
+		draw_run();
+		goto become_idle;
+
+	case serport_scroll_op:
+		arg.scroll.op = c;
+		arg.scroll.n = 0;
+		if(c & SCROLL_DATA){
+			serport_state = serport_scroll_data;
+			break;
+		}
+		scroll(c,0);
+		goto become_idle;
+
+	case serport_scroll_data:
+		arg.scroll.line[arg.scroll.n++] = c;
+		if(arg.scroll.n < sizeof(arg.scroll.line))
+			break;
+		scroll(arg.scroll.op,arg.scroll.line);
+		goto become_idle;
+
+	case serport_page:
+		page(c);
+		goto become_idle;
+
+	case serport_terminal:
+		if(c >= 0x20)
+			tm_count(printable,1);
+		if(term_char(c))
+			goto become_idle;
+		break;
+
 	case serport_pos_cursor_x:
 		serport_data = c;
 		serport_state = serport_pos_cursor_y;
@@ -292,43 +860,44 @@ eat_char(uint8_t c){
 		lcd_command_2(CMD_CURSOR_POS,serport_data,c);
 		goto become_idle;
 
+	case serport_print:
+		if(c>=0x20){
+			lcd_auto_write(c-0x20);
+			tm_count(printable,1);
+			break;
+		}
+		lcd_auto_reset();
+		serport_state = serport_idle;
+		/* fall through, c is a control char */
 	default: /* =idle */
 		if(c>=0x20){ /* write text char -> add 0x20 to match ASCII */
-			lcd_command_1(CMD_DATA_WRITE_INC,c-0x20);
+			/* in auto mode until a control char, or until the
+			   input stays dry for a while (main_idle()) */
+			lcd_command(CMD_AUTO_WRITE);
+			lcd_auto_write(c-0x20);
+			tm_count(printable,1);
+			serport_state = serport_print;
 			break;
 		}
+		tm_count(cmd[c],1);
+		serport_state = pgm_read_byte(&serport_cmd[c]);
 		switch(c){
-		case CHAR_WRITE:
-			serport_state = serport_write_data;
-			break;
-		case CHAR_ECHO:
-			serport_state = serport_echo;
-			break;
-		case CHAR_ADDR:
-			serport_state = serport_set_addr_lo;
-			break;
 		case CHAR_RESET:
 			lcd_hardware_init();
+			scroll_reset();
+			page_reset();
 			break;
 		case CHAR_STATUS:
 			lcd_command_read(CMD_DATA_READ_INC,&c);
 			put_char(c);
 			break;
-		case CHAR_MODE:
-			serport_state = serport_mode;
-			break;
-		case CHAR_DISP:
-			serport_state = serport_disp;
-			break;
-		case CHAR_CURSOR:
-			serport_state = serport_cursor;
-			break;
 		case CHAR_BULK:
+		case CHAR_PACKED:
 			lcd_command(CMD_AUTO_WRITE);
-			serport_state = serport_bulk_count;
 			break;
-		case CHAR_POS_CURSOR:
-			serport_state = serport_pos_cursor_x;
+		case CHAR_TERMINAL:
+			term_start();
+			break;
 		}
 		break;
 	}
@@ -339,42 +908,156 @@ become_idle:
 serport_out:
 	global_serport_state = serport_state;
 	global_serport_data  = serport_data;
+	EAT_COUNT(1);
 }
 
+/* Eat len bytes, return the number eaten: less if one of them started a
+   readback. Payload runs, the data of ^I, ^K (and ^O) and literals of
+   ^L, and printable text (in auto mode, see serport_print), go to the
+   LCD in one loop each, with the state in registers; everything else
+   goes through eat_char(). */
+static uint8_t
+eat_buffer(const uint8_t *buf,uint8_t len){
+	const uint8_t *p = buf, *end = buf + len;
+	uint8_t n, k;
 
-/* ---------- initial data to show after powerup ---- */
-PROGMEM char initial_data[]={
-	'H','e','l','l','o',' ','W','o','r','l','d','!'
-};
-unsigned char initial_readptr=0;
+	while(p != end && !readback_left){
+		n = end - p;
+		switch(global_serport_state){
 
-int main(){
+		case serport_bulk_data: /* serport_data counts, 0: 256 */
+			k = global_serport_data;
+			if(k && k < n)
+				n = k;
+			for(k=n;k;k--)
+				lcd_auto_write(*p++);
+			if((global_serport_data -= n) == 0){
+				lcd_auto_reset();
+				global_serport_state = serport_idle;
+			}
+			break;
+
+		case serport_lbulk_data:
+			if(global_serport_count < n)
+				n = global_serport_count;
+			for(k=n;k;k--)
+				lcd_auto_write(*p++);
+			if((global_serport_count -= n) == 0){
+				lcd_auto_reset();
+				global_serport_state = serport_idle;
+			}
+			break;
+
+		case serport_pack_literal:
+			if(global_serport_data < n)
+				n = global_serport_data;
+			for(k=n;k;k--)
+				lcd_auto_write(*p++);
+			if((global_serport_data -= n) == 0)
+				global_serport_state = serport_pack_op;
+			break;
+
+		case serport_idle:
+		case serport_print:
+			if(*p < 0x20){
+				eat_char(*p++);
+				continue;
+			}
+			if(global_serport_state == serport_idle){
+				lcd_command(CMD_AUTO_WRITE);
+				global_serport_state = serport_print;
+			}
+			for(k=0;p != end && *p >= 0x20;k++,p++)
+				lcd_auto_write(*p-0x20);
+			tm_count(printable,k);
+			break;
+
+		default:
+			eat_char(*p++);
+			continue;
+		}
+		EAT_COUNT(1);
+	}
+	return p - buf;
+}
+
+/* the input ran dry: leave the auto mode of a run of text, the LCD
+   takes no other commands meanwhile */
+static void
+print_idle(){
+	if(global_serport_state == serport_print){
+		lcd_auto_reset();
+		global_serport_state = serport_idle;
+	}
+}
+
+/* Over the serial port the input runs dry after every byte, so the
+   main loop only counts as idle once nothing came in for IDLE_TICKS
+   (Timer1, F_CPU/256): a run of text stays in one auto write session
+   across the gaps, the terminal writes whole spans. */
+#define IDLE_TICKS ((uint16_t)(F_CPU / 256 / 250))       /* 4 ms */
+
+static uint16_t idle_t0;
+
+/* main loop, busy: something was eaten or a readback is pending */
+static void
+main_idle(uint8_t busy){
+	uint16_t t = TCNT1;
+	if(busy)
+		idle_t0 = t;
+	else if((uint16_t)(t - idle_t0) > IDLE_TICKS){
+		print_idle();
+		term_idle(); /* cursor */
+	}
+}
+
+
+/* ---------- boot screen to show after powerup ---- */
+#include "splash.h" /* generated by mksplash.py */
+
+/* set up LCD pins and serial port, also used by the host bench (sim/) */
+static void
+io_init(){
 	/* init LCD pins */
 	DDRD= PORTD_CD | PORTD_RES; /* CD, RES is AVR output, default to 0 */
 	PORTB=PORTB_RD | PORTB_WR;  /* \RD, \WR at 1, bus is idle */
 	DDRB= PORTB_RD | PORTB_WR | PORTB_CS;  /* RD, WR, CS is AVR output */
+	DDRB |= PORTB_RTS; /* RTS low: host may send */
 
 	/* setup serial port */
 	UCSR0A = _BV(U2X0); /* double uart clock */
-	UCSR0B = /*_BV(RXCIE0) |*/ _BV(RXEN0) | _BV(TXEN0);
+	UCSR0B = _BV(RXCIE0) | _BV(RXEN0) | _BV(TXEN0);
 	UCSR0C = _BV(UCSZ01) | _BV(UCSZ00); /* 8 bit */
-	UBRR0 = 155; /* 18 MHz / 156 = 115384 bps = 115k2 + 0.16% */
+	UBRR0 = BAUD_DEFAULT; /* 18 MHz / 8 / 20 = 112500 bps = 115k2 - 2.3% */
+
+	TCCR1A = 0;
+	TCCR1B = _BV(CS12); /* Timer1, normal mode, F_CPU/256 */
+	tm_init();
+}
+
+int main(){
+	io_init();
+	/* before interrupts and USB: it measures the controller */
+	lcd_hardware_setup();
 
 	sei();
 	usbInit();
 	usbDeviceConnect();
 
-	lcd_hardware_init();
+	/* the splash covers text and graphics area, no need to clear */
+#if TERM_BOOT
+	eat_char(CHAR_TERMINAL);
+#else
+	lcd_unpack_P(LCD_TEXT_BASE,splash);
+#endif
 
 	while(1){
-		unsigned char c;
-		if(initial_readptr < sizeof(initial_data)){
-			c = pgm_read_byte(initial_data + initial_readptr);
-			initial_readptr++;
-			eat_char(c);
-		}
-		if(get_char(&c)==0)
-			eat_char(c);
+		tm_loop();
+		main_idle(input_drain(INPUT_BATCH) || readback_left);
+		baud_poll();
+		if(readback_left && !readback_usb)
+			readback_pump();
+		flow_go();
 		usbPoll();
 	}
 }
@@ -0,0 +1,638 @@
+# host side helpers for the everavr LCD firmware, see everavr.c and
+# protocol.h for the protocol
+
+import os
+import struct
+import time
+
+# display RAM layout set up by lcd_hardware_setup()
+TEXT_BASE    = 0x0000
+TEXT_COLS    = 40
+TEXT_LINES   = 8
+GRAPHIC_BASE = 0x0140
+GRAPHIC_COLS = 40      # bytes per line, 6 pixels each
+WIDTH        = 240
+HEIGHT       = 64
+
+# command characters, see protocol.h
+CHAR_WRITE      = 0x01
+CHAR_ECHO       = 0x02
+CHAR_ADDR       = 0x03
+CHAR_STATUS     = 0x04
+CHAR_RESET      = 0x05
+CHAR_MODE       = 0x06
+CHAR_DISP       = 0x07
+CHAR_CURSOR     = 0x08
+CHAR_BULK       = 0x09
+CHAR_LBULK      = 0x0b
+CHAR_PACKED     = 0x0c
+CHAR_TEXT       = 0x0e
+CHAR_TILES      = 0x0f
+CHAR_POS_CURSOR = 0x10
+CHAR_READ       = 0x12
+CHAR_TELEMETRY  = 0x14
+CHAR_BAUD       = 0x15
+CHAR_DRAW       = 0x16
+CHAR_SCROLL     = 0x17
+CHAR_PAGE       = 0x18
+CHAR_TERMINAL   = 0x19
+
+TELEMETRY_CLEAR = 0x01
+
+BAUD_CLOCK      = 2250000  # ^U n: BAUD_CLOCK/(n+1) bps
+BAUD_DEFAULT    = 19
+BAUD_RESET      = BAUD_CLOCK//(BAUD_DEFAULT+1) # 112500, after reset
+
+DRAW_SET    = 0x00
+DRAW_XOR    = 0x01
+DRAW_CLEAR  = 0x02
+DRAW_OPAQUE = 0x04
+FONT_BOLD   = 0x10     # TEXT_FONT(1)
+
+# ^V primitives
+DRAW_PLOT   = 0x00
+DRAW_HLINE  = 0x10
+DRAW_VLINE  = 0x20
+DRAW_LINE   = 0x30
+DRAW_RECT   = 0x40
+DRAW_FILL   = 0x50
+
+# ^W
+SCROLL_TEXT     = 0x00
+SCROLL_GRAPHICS = 0x01
+SCROLL_UP       = 0x00
+SCROLL_DOWN     = 0x02
+SCROLL_OFF      = 0x04
+SCROLL_DATA     = 0x08
+
+# ^X
+PAGE_BACK   = 0x01
+PAGE_FLIP   = 0x02
+PAGE_TEXT   = 0x04
+PAGE_COPY   = 0x08
+TEXT_MAX    = 48       # GFX_TEXT_MAX, chars the device draws per ^N
+
+MODE_EXT_CG = 0x08     # ^F: all character codes from CG RAM
+TILE_SIZE   = 8        # bytes per ^O tile
+TILE_INT_CG = 0x80     # first CG RAM code with the internal CG
+
+# packed format, see protocol.h
+PACK_END    = 0x00
+PACK_REPEAT = 0x80
+PACK_ZERO   = 0xc0
+
+def read_pbm(fn) :
+	'''Read a 240x64 ASCII (P1) PBM, return list of rows of 0/1
+	(1 = black = pixel on).'''
+	fmt = None
+	size = None
+	data = ''
+	for l in open(fn) :
+		l = l.strip()
+		if l == '' or l[0] == '#' :
+			continue
+		if fmt == None :
+			if l != 'P1' :
+				raise RuntimeError('Only P1 ASCII format is supported, not %s.'%(l))
+			fmt = l
+			continue
+		if size == None :
+			x,y = map(int,l.split())
+			if x != WIDTH or y != HEIGHT :
+				raise RuntimeError('Only %d x %d pixel is supported, not %d x %d.'%(
+					WIDTH,HEIGHT,x,y))
+			size = (x,y)
+			continue
+		data = data + ''.join(l.split())
+	if len(data) != WIDTH*HEIGHT :
+		raise RuntimeError('Too little or too much data read; want %d, got %d.'%(
+			WIDTH*HEIGHT,len(data)))
+	return [ [ int(data[y*WIDTH+x]) for x in range(WIDTH) ]
+		for y in range(HEIGHT) ]
+
+def pack_pixels(rows) :
+	'''Convert rows of 0/1 pixels to graphics plane bytes, 6 pixels per
+	byte with the leftmost pixel in bit 5.'''
+	out = bytearray()
+	for row in rows :
+		for x in range(0,WIDTH,6) :
+			d = 0
+			for c in range(6) :
+				if row[x+c] :
+					d |= 1<<(5-c)
+			out.append(d)
+	return bytes(out)
+
+def text_bytes(s) :
+	'''ASCII to the controller's character codes.'''
+	return bytes(bytearray((ord(c)-0x20) & 0xff for c in s))
+
+def pack(data,end=True) :
+	'''Compress display RAM contents into the packed format.'''
+	data = bytearray(data)
+	out = bytearray()
+	lit = bytearray()
+	i = 0
+
+	def flush() :
+		out.append(len(lit))
+		out.extend(lit)
+		del lit[:]
+
+	while i < len(data) :
+		b = data[i]
+		n = 1
+		while i+n < len(data) and data[i+n] == b :
+			n += 1
+		if n < 3 :
+			lit.extend(data[i:i+n])
+			i += n
+			while len(lit) >= 0x7f :
+				rest = lit[0x7f:]
+				del lit[0x7f:]
+				flush()
+				lit.extend(rest)
+			continue
+		if lit :
+			flush()
+		i += n
+		while n :
+			if b == 0 :
+				k = min(n,0x4000)
+				out.append(PACK_ZERO | ((k-1) >> 8))
+				out.append((k-1) & 0xff)
+			elif n == 1 :
+				k = 1
+				lit.append(b)
+			else :
+				k = min(n,0x41)
+				out.append(PACK_REPEAT | (k-2))
+				out.append(b)
+			n -= k
+	if lit :
+		flush()
+	if end :
+		out.append(PACK_END)
+	return bytes(out)
+
+def unpack(data) :
+	'''Inverse of pack(), for checking.'''
+	data = bytearray(data)
+	out = bytearray()
+	i = 0
+	while i < len(data) and data[i] != PACK_END :
+		c = data[i]
+		if c < PACK_REPEAT :
+			out.extend(data[i+1:i+1+c])
+			i += 1+c
+		elif c < PACK_ZERO :
+			out.extend(bytearray([data[i+1]]) * ((c & 0x3f)+2))
+			i += 2
+		else :
+			out.extend(bytearray(((c & 0x3f) << 8 | data[i+1]) + 1))
+			i += 2
+	return bytes(out)
+
+# ---------- command encoders, all return bytes ----------
+
+def cmd_addr(addr) :
+	return bytes(bytearray([CHAR_ADDR, addr & 0xff, addr >> 8]))
+
+def cmd_mode(mode) :
+	'''^F: CMD_MODE_* bits, e.g. MODE_EXT_CG.'''
+	return bytes(bytearray([CHAR_MODE, mode]))
+
+def cmd_lbulk(data) :
+	n = len(data)
+	return bytes(bytearray([CHAR_LBULK, n & 0xff, n >> 8])) + bytes(data)
+
+def cmd_packed(data) :
+	return bytes(bytearray([CHAR_PACKED])) + pack(data)
+
+def cmd_read(addr,n) :
+	'''^R: the device answers with n bytes of display RAM from addr.'''
+	return bytes(bytearray([CHAR_READ, addr & 0xff, addr >> 8,
+		n & 0xff, n >> 8]))
+
+def cmd_telemetry(clear=False) :
+	'''^T: the device answers with its telemetry block, see
+	parse_telemetry(); clear=True zeroes the counters instead.'''
+	return bytes(bytearray([CHAR_TELEMETRY,
+		TELEMETRY_CLEAR if clear else 0]))
+
+def cmd_baud(rate) :
+	'''^U: switch the serial port to the nearest rate the device does;
+	it goes back to BAUD_RESET unless a ^B follows at the new rate, see
+	Device.baud().'''
+	n = (BAUD_CLOCK + rate//2) // rate - 1
+	return bytes(bytearray([CHAR_BAUD, max(1,min(n,0xff))]))
+
+def cmd_text(x,y,s,flags=DRAW_SET) :
+	'''^N: draw s in the device's proportional font, top left corner at
+	pixel x,y; flags are DRAW_*, DRAW_OPAQUE and FONT_BOLD.'''
+	s = bytearray(c if isinstance(c,int) else ord(c) for c in s[:TEXT_MAX])
+	return bytes(bytearray([CHAR_TEXT, x, y, flags, len(s)]) + s)
+
+def cmd_draw(op,*args) :
+	'''^V: op is DRAW_PLOT.. | DRAW_SET/XOR/CLEAR, args pixel
+	coordinates as listed in protocol.h.'''
+	return bytes(bytearray([CHAR_DRAW, op] + list(args)))
+
+def cmd_plot(x,y,mode=DRAW_SET) :
+	return cmd_draw(DRAW_PLOT|mode,x,y)
+
+def cmd_hline(x0,x1,y,mode=DRAW_SET) :
+	return cmd_draw(DRAW_HLINE|mode,x0,x1,y)
+
+def cmd_vline(x,y0,y1,mode=DRAW_SET) :
+	return cmd_draw(DRAW_VLINE|mode,x,y0,y1)
+
+def cmd_line(x0,y0,x1,y1,mode=DRAW_SET) :
+	return cmd_draw(DRAW_LINE|mode,x0,y0,x1,y1)
+
+def cmd_rect(x0,y0,x1,y1,mode=DRAW_SET) :
+	return cmd_draw(DRAW_RECT|mode,x0,y0,x1,y1)
+
+def cmd_fill(x0,y0,x1,y1,mode=DRAW_SET) :
+	'''mode=DRAW_CLEAR clears the rectangle.'''
+	return cmd_draw(DRAW_FILL|mode,x0,y0,x1,y1)
+
+def cmd_scroll(op,line=None) :
+	'''^W: op is SCROLL_UP/DOWN/OFF | SCROLL_TEXT/GRAPHICS; line, 40
+	bytes (text codes or pixel bytes), is the line that scrolls in,
+	None clears it.'''
+	if line == None :
+		return bytes(bytearray([CHAR_SCROLL, op]))
+	line = bytearray(line)
+	if len(line) != GRAPHIC_COLS :
+		raise ValueError('a line is %d bytes'%(GRAPHIC_COLS))
+	return bytes(bytearray([CHAR_SCROLL, op | SCROLL_DATA]) + line)
+
+def cmd_page(op) :
+	'''^X: e.g. cmd_page(PAGE_BACK) before a frame, cmd_page(PAGE_FLIP|
+	PAGE_BACK) after it, the next one goes to the hidden page again.'''
+	return bytes(bytearray([CHAR_PAGE, op]))
+
+def cmd_terminal() :
+	'''^Y: enter terminal mode (term.h), everything after it is text with
+	CR/LF/BS/TAB and ANSI escapes; the same again leaves.'''
+	return bytes(bytearray([CHAR_TERMINAL]))
+
+def cmd_tiles(slot,tiles) :
+	'''^O: upload tiles (8 bytes each, see tile_cells()) to CG RAM, for
+	character codes slot.. on.'''
+	out = bytearray()
+	for i in range(0,len(tiles),256) :
+		t = tiles[i:i+256]
+		out += bytearray([CHAR_TILES, (slot+i) & 0xff, len(t) & 0xff])
+		for b in t :
+			out += bytearray(b)
+	return bytes(out)
+
+def cmd_write_best(data) :
+	'''^K or ^L, whichever is shorter for data.'''
+	a = cmd_lbulk(data)
+	b = cmd_packed(data)
+	if len(b) < len(a) :
+		return b
+	return a
+
+# ---------- shadow copy of display RAM, minimal updates ----------
+
+class Shadow :
+	'''Keeps a copy of what should be in the text area and graphics
+	plane (see lcd_hardware_setup()) and turns new frames into the
+	cheapest command stream, counted in bytes on the wire, that gets
+	the display there.
+
+	Changed bytes are grouped into spans; neighbouring spans are merged
+	when rewriting the unchanged bytes in between is cheaper than a new
+	^C address set (3 bytes), unless the controller's address pointer
+	is already where the next span starts. Each span goes out as
+	printable characters (value+0x20, 1 byte each, ^A for values above
+	0xdf), ^I/^K bulk or ^L packed, whichever is shortest.'''
+
+	SIZE = GRAPHIC_BASE + GRAPHIC_COLS*HEIGHT  # text area + graphics
+	ADDR_COST = 3
+	MAX_MERGE = 64  # spans considered for merging, bounds the DP
+
+	def __init__(self,known=False) :
+		'''known=True: display RAM is all zeroes (after ^E).'''
+		self.ram = bytearray(self.SIZE)
+		self.valid = bytearray([1 if known else 0]) * self.SIZE
+		self.adp = None  # controller address pointer, None: unknown
+
+	def invalidate(self) :
+		'''Forget what's on the display, e.g. after a power glitch.'''
+		self.valid = bytearray(self.SIZE)
+		self.adp = None
+
+	def resync(self,addr,data) :
+		'''Take data, read back with cmd_read(addr,len(data)), as what's
+		on the display, e.g. after a power glitch, instead of repainting:
+		the next update() only sends what really differs.'''
+		n = len(data)
+		self.ram[addr:addr+n] = bytearray(data)
+		self.valid[addr:addr+n] = bytearray([1]) * n
+		self.adp = addr + n
+
+	def reset(self) :
+		'''Returns ^E, after which the display RAM is known to be 0.'''
+		self.ram = bytearray(self.SIZE)
+		self.valid = bytearray([1]) * self.SIZE
+		self.adp = None
+		return bytes(bytearray([CHAR_RESET]))
+
+	def text(self,lines) :
+		'''New contents of the 40x8 text area, list of strings.'''
+		t = bytearray(TEXT_COLS*TEXT_LINES)
+		for y,line in enumerate(lines[:TEXT_LINES]) :
+			line = text_bytes(line[:TEXT_COLS])
+			t[y*TEXT_COLS:y*TEXT_COLS+len(line)] = line
+		return self.update(TEXT_BASE,t)
+
+	def graphics(self,data) :
+		'''New contents of the graphics plane, 2560 bytes as produced by
+		pack_pixels().'''
+		return self.update(GRAPHIC_BASE,data)
+
+	def update(self,addr,data) :
+		'''Make display RAM at addr.. equal to data, return the command
+		bytes needed to do so.'''
+		data = bytearray(data)
+		end = addr + len(data)
+		if addr < 0 or end > self.SIZE :
+			raise ValueError('update outside of text/graphics area')
+
+		# runs of bytes that differ (or are unknown): [start,end)
+		runs = []
+		i = addr
+		while i < end :
+			if self.valid[i] and self.ram[i] == data[i-addr] :
+				i += 1
+				continue
+			j = i
+			while j < end and not (self.valid[j] and
+			    self.ram[j] == data[j-addr]) :
+				j += 1
+			runs.append((i,j))
+			i = j
+		if not runs :
+			return b''
+
+		want = bytearray(self.ram)
+		want[addr:end] = data
+		# hi[i]: bytes > 0xdf in want[:i], these need ^A in text mode
+		hi = [0]
+		for b in want :
+			hi.append(hi[-1] + (b > 0xdf))
+
+		# best[k]: (cost, start index of last span) covering runs[:k]
+		best = [ (0,None) ]
+		for k in range(1,len(runs)+1) :
+			cand = None
+			for j in range(max(0,k-self.MAX_MERGE),k) :
+				start,stop = runs[j][0],runs[k-1][1]
+				if j == 0 :
+					addr_cost = 0 if self.adp == start else self.ADDR_COST
+				else :
+					addr_cost = self.ADDR_COST
+				c = best[j][0] + addr_cost + \
+					self._cost(stop-start,hi[stop]-hi[start])
+				if cand == None or c < cand[0] :
+					cand = (c,j)
+			best.append(cand)
+
+		# walk back, then emit front to back
+		spans = []
+		k = len(runs)
+		while k > 0 :
+			j = best[k][1]
+			spans.append((runs[j][0],runs[k-1][1]))
+			k = j
+		spans.reverse()
+
+		out = bytearray()
+		for start,stop in spans :
+			if self.adp != start :
+				out += cmd_addr(start)
+			out += self._span(want[start:stop])[1]
+			self.adp = stop
+		self.ram[addr:end] = data
+		self.valid[addr:end] = bytearray([1]) * len(data)
+		return bytes(out)
+
+	@staticmethod
+	def _cost(n,hi) :
+		'''Bytes on the wire for a span of n bytes, hi of them > 0xdf,
+		without trying ^L (too slow for the merge search).'''
+		if n <= 256 :
+			return min(n+hi, n+2)
+		return min(n+hi, n+3)
+
+	@staticmethod
+	def _span(d) :
+		'''(cost, command bytes) of the cheapest way to write d at the
+		current address pointer.'''
+		n = len(d)
+		out = bytearray()
+		for b in d :
+			if b > 0xdf :
+				out += bytearray([CHAR_WRITE,b])
+			else :
+				out.append(b+0x20)
+		best = out
+		if n <= 256 and n+2 < len(best) :
+			best = bytearray([CHAR_BULK, n & 0xff]) + d
+		elif n > 256 and n+3 < len(best) :
+			best = bytearray(cmd_lbulk(d))
+		if n >= 16 :
+			p = cmd_packed(d)
+			if len(p) < len(best) :
+				best = bytearray(p)
+		return (len(best),bytes(best))
+
+# ---------- CG RAM tiles, text plane codes instead of pixels ----------
+
+def tile_cells(rows) :
+	'''Cut rows of 0/1 pixels (240x64) into the 40x8 cells of the text
+	area, return one 8 byte tile per cell (row by row, bits 5..0 left
+	to right, the CG RAM layout).'''
+	cells = []
+	for cy in range(TEXT_LINES) :
+		for cx in range(TEXT_COLS) :
+			t = bytearray()
+			for y in range(8) :
+				row = rows[cy*8+y]
+				t.append(sum(1 << (5-c) for c in range(6)
+					if row[cx*6+c]))
+			cells.append(bytes(t))
+	return cells
+
+class TileCache :
+	'''Keeps track of the tiles in CG RAM, so an image made of
+	repeating 6x8 cells (icons, frames, big digits) goes to the text area
+	as one character code per cell; only tiles not seen before are
+	uploaded with ^O.
+
+	With the internal CG the ROM font stays usable and there are 128
+	slots (codes 0x80..0xff), a blank cell is the ROM space. ext=True
+	takes all 256 codes from CG RAM, the caller has to switch with
+	cmd_mode(MODE_EXT_CG) (the firmware keeps uploaded tiles).'''
+
+	def __init__(self,ext=False) :
+		self.ext = ext
+		self.first = 0 if ext else TILE_INT_CG
+		self.reset()
+
+	def reset(self) :
+		'''Forget the uploaded tiles, e.g. after ^E.'''
+		self.codes = {}
+		self.next = self.first
+
+	def screen(self,rows) :
+		'''Returns (commands, codes): the ^O uploads of new tiles and
+		the 320 text area codes that show rows. Raises ValueError if the
+		image needs more tiles than there are slots.'''
+		new = []
+		codes = bytearray()
+		for t in tile_cells(rows) :
+			if not self.ext and not any(bytearray(t)) :
+				codes.append(0)
+				continue
+			if t not in self.codes :
+				if self.next > 0xff :
+					raise ValueError('more than %d different tiles'%(
+						0x100-self.first))
+				self.codes[t] = self.next
+				self.next += 1
+				new.append(t)
+			codes.append(self.codes[t])
+		cmds = cmd_tiles(self.next-len(new),new) if new else b''
+		return cmds,bytes(codes)
+
+# ---------- telemetry, struct telemetry in telemetry.h ----------
+
+TM_VERSION = 3
+TM_BUCKETS = 8
+TM_POLLS = ('cmd','auto_wr','auto_rd')
+TM_FORMAT = '<BBH4I%dH%dH4H3H3H32H'%(len(TM_POLLS)*TM_BUCKETS,TM_BUCKETS)
+TM_SIZE = struct.calcsize(TM_FORMAT)
+
+def parse_telemetry(data) :
+	'''Dict from the ^T answer: scalars by name, poll/loop histograms
+	as lists (bucket i: 2**i .. 2**(i+1)-1, the last is open; halved
+	whenever a bucket would pass 65535, so only relative), poll
+	timeouts in poll_timeout, control chars by code in cmd.'''
+	v = struct.unpack(TM_FORMAT,bytes(data[:TM_SIZE]))
+	if v[0] != TM_VERSION or v[1] != TM_SIZE :
+		raise ValueError('telemetry version %d size %d, want %d/%d'%(
+			v[0],v[1],TM_VERSION,TM_SIZE))
+	t = dict(zip(('version','size','tick_ns','rx_uart','rx_usb','tx',
+		'printable'),v[:7]))
+	i = 7
+	t['poll'] = {}
+	for name in TM_POLLS :
+		t['poll'][name] = list(v[i:i+TM_BUCKETS])
+		i += TM_BUCKETS
+	t['loop'] = list(v[i:i+TM_BUCKETS])
+	i += TM_BUCKETS
+	t.update(zip(('uart_lost','uart_overrun','tx_lost','loop_max'),v[i:i+4]))
+	i += 4
+	t['poll_timeout'] = dict(zip(TM_POLLS,v[i:i+3]))
+	t.update(zip(('readback_cancel','uart_stops','usb_stops'),v[i+3:i+6]))
+	t['cmd'] = list(v[i+6:i+6+32])
+	return t
+
+# ---------- talking to the device ----------
+
+def _hidiocgfeature(n) :
+	return (3 << 30) | (n << 16) | (ord('H') << 8) | 0x07
+
+class Device :
+	'''The protocol stream to /dev/hidrawN (128 byte HID reports) or a
+	serial port, and what the firmware sends back (^B, ^D, ^R, ^T).'''
+
+	REPORT = 128
+
+	def __init__(self,path,baud=BAUD_RESET) :
+		self.hid = path.startswith('/dev/hidraw')
+		if self.hid :
+			self.fd = os.open(path,os.O_RDWR)
+		else :
+			import serial
+			# the firmware stops us with RTS, see everavr.c
+			self.ser = serial.Serial(path,baud,timeout=1,rtscts=True)
+
+	def write(self,data) :
+		data = bytes(data)
+		if not self.hid :
+			self.ser.write(data)
+			return
+		for i in range(0,len(data),self.REPORT) :
+			os.write(self.fd,b'\0' + data[i:i+self.REPORT])
+
+	def read(self,n) :
+		'''n bytes of an answer; over USB in GET_REPORTs, see protocol.h.'''
+		if not self.hid :
+			data = self.ser.read(n)
+			if len(data) < n :
+				raise IOError('timeout, got %d of %d bytes'%(len(data),n))
+			return data
+		import fcntl
+		out = bytearray()
+		while len(out) < n :
+			rep = bytearray(1+self.REPORT)
+			got = fcntl.ioctl(self.fd,_hidiocgfeature(len(rep)),rep,True)
+			out += rep[1:got]
+			if got-1 < self.REPORT :
+				break
+		if len(out) < n :
+			raise IOError('short answer, got %d of %d bytes'%(len(out),n))
+		return bytes(out[:n])
+
+	def ping(self,seq) :
+		'''^B round trip over the serial port, True if seq comes back.'''
+		self.write([CHAR_ECHO,seq])
+		for i in range(16) :
+			b = self.ser.read(1)
+			if len(b) < 1 :
+				return False
+			if bytearray(b)[0] == seq :
+				return True
+		return False
+
+	def baud(self,rate=0) :
+		'''Serial port only: switch to rate with ^U, confirmed by a ^B
+		at it, else back to BAUD_RESET; rate 0 tries the fastest first
+		(1.125M, 750k, 562.5k, 450k). Returns the rate in use, None
+		over USB.'''
+		if self.hid :
+			return None
+		if rate == 0 :
+			for d in range(2,6) :
+				if self.baud(BAUD_CLOCK//d) != BAUD_RESET :
+					return BAUD_CLOCK//d
+			return BAUD_RESET
+		# both ends back at BAUD_RESET, whatever happened before
+		self.ser.flush()
+		self.ser.baudrate = BAUD_RESET
+		self.ser.send_break(0.002)
+		self.ser.reset_input_buffer()
+		d = (BAUD_CLOCK + rate//2) // rate
+		got = BAUD_CLOCK // d if d else 0
+		if d < 2 or d > BAUD_DEFAULT or \
+		   abs(got - rate) * 50 > rate :
+			return BAUD_RESET # not within 2%
+		if self.ping(0xa5) :
+			self.write(cmd_baud(got))
+			self.ser.flush()
+			time.sleep(0.002) # it switches two characters later
+			self.ser.baudrate = got
+			self.ser.reset_input_buffer()
+			if self.ping(0x5a) :
+				return got
+		self.ser.baudrate = BAUD_RESET
+		self.ser.send_break(0.002)
+		self.ser.reset_input_buffer()
+		return BAUD_RESET
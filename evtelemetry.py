@@ -0,0 +1,46 @@
+#!/usr/bin/python
+# dump the firmware's telemetry block (^T, see telemetry.h)
+#
+#   evtelemetry.py [-c] [-b baud] device
+#
+# device is /dev/hidrawN or a serial port; -c zeroes the counters after
+# reading them.
+
+import sys
+import getopt
+import everavr
+
+opts,args = getopt.getopt(sys.argv[1:],'cb:')
+opts = dict(opts)
+if len(args) != 1 :
+	sys.exit('usage: %s [-c] [-b baud] device'%(sys.argv[0]))
+
+dev = everavr.Device(args[0],int(opts.get('-b',everavr.BAUD_RESET)))
+dev.write(everavr.cmd_telemetry())
+t = everavr.parse_telemetry(dev.read(everavr.TM_SIZE))
+if '-c' in opts :
+	dev.write(everavr.cmd_telemetry(clear=True))
+
+def hist(h) :
+	return ' '.join('%8d'%(n) for n in h)
+
+names = dict((getattr(everavr,n),n[5:].lower()) for n in dir(everavr)
+	if n.startswith('CHAR_'))
+
+print('rx uart %d usb %d, tx %d' % (t['rx_uart'],t['rx_usb'],t['tx']))
+print('lost: uart rx %d (overrun %d), tx %d, usb readbacks %d' % (
+	t['uart_lost'],t['uart_overrun'],t['tx_lost'],t['readback_cancel']))
+print('flow control stops: uart %d, usb %d' % (t['uart_stops'],t['usb_stops']))
+print('text chars %d' % (t['printable']))
+print('commands ' + ', '.join('%s %d'%(names.get(c,'0x%02x'%(c)),n)
+	for c,n in enumerate(t['cmd']) if n))
+print('')
+print('%-12s'%('polls') + ' '.join('%8s'%('%d-'%(1 << b)) for b in range(8))
+	+ ' timeouts')
+for name in everavr.TM_POLLS :
+	print('%-12s'%(name) + hist(t['poll'][name])
+		+ ' %8d'%(t['poll_timeout'][name]))
+tick = t['tick_ns'] / 1000.0
+print('%-12s'%('loop us') + ' '.join('%8s'%('%.0f-'%((1 << b)*tick if b else 0))
+	for b in range(8)))
+print('%-12s'%('') + hist(t['loop']) + '   max %.0f us'%(t['loop_max']*tick))
@@ -0,0 +1,33 @@
+#!/usr/bin/python
+# show a 240x64 PBM through the text area: the image is cut into 6x8
+# cells, the distinct ones are uploaded to CG RAM (^O) and every cell
+# becomes one character code (see everavr.TileCache)
+#
+#   evtiles.py [-e] [-b baud] image.pbm device
+#
+# device is /dev/hidrawN or a serial port; -e switches to the external
+# CG, 256 tiles instead of 128 next to the ROM font. The graphics plane
+# is left alone, it is OR'ed with the text.
+
+import sys
+import getopt
+import everavr
+
+opts,args = getopt.getopt(sys.argv[1:],'eb:')
+opts = dict(opts)
+if len(args) != 2 :
+	sys.exit('usage: %s [-e] [-b baud] image.pbm device'%(sys.argv[0]))
+
+cache = everavr.TileCache(ext='-e' in opts)
+try :
+	cmds,codes = cache.screen(everavr.read_pbm(args[0]))
+except ValueError as e :
+	sys.exit('%s: %s'%(args[0],e))
+
+dev = everavr.Device(args[1],int(opts.get('-b',everavr.BAUD_RESET)))
+dev.write(cmds)
+dev.write(everavr.cmd_mode(everavr.MODE_EXT_CG if cache.ext else 0))
+dev.write(everavr.cmd_addr(everavr.TEXT_BASE)
+	+ everavr.cmd_write_best(codes))
+sys.stderr.write('%d tiles, %d bytes\n'%(cache.next-cache.first,
+	len(cmds)+len(codes)))
@@ -0,0 +1,108 @@
+/* proportional 8 pixel fonts, chars 0x20..0x7e, 346+441 bytes of
+   glyph columns, generated by mkfont.py */
+#define FONT8_HEIGHT  8
+#define FONT8_FIRST   0x20
+#define FONT8_LAST    0x7e
+#define FONT8_SPACING 1
+
+static PROGMEM const uint16_t font8_offs[96] = {
+	  0,   2,   3,   6,  11,  16,  21,  26,
+	 27,  29,  31,  36,  41,  43,  47,  48,
+	 52,  56,  59,  63,  67,  71,  75,  79,
+	 83,  87,  91,  92,  94,  97, 101, 104,
+	108, 113, 117, 121, 125, 129, 133, 137,
+	141, 145, 148, 152, 156, 160, 165, 169,
+	173, 177, 181, 185, 189, 194, 198, 203,
+	208, 213, 218, 222, 224, 228, 230, 233,
+	237, 239, 243, 247, 250, 254, 258, 261,
+	265, 269, 270, 272, 276, 278, 283, 287,
+	291, 295, 299, 302, 306, 309, 313, 318,
+	323, 327, 331, 335, 338, 339, 342, 346,
+};
+
+static PROGMEM const uint8_t font8_cols[346] = {
+	0x00, 0x00, 0x5f, 0x03, 0x00, 0x03, 0x14, 0x7f, 0x14, 0x7f, 0x14, 0x24,
+	0x2a, 0x7f, 0x2a, 0x12, 0x23, 0x13, 0x08, 0x64, 0x62, 0x36, 0x49, 0x55,
+	0x22, 0x50, 0x03, 0x3e, 0x41, 0x41, 0x3e, 0x14, 0x08, 0x3e, 0x08, 0x14,
+	0x08, 0x08, 0x3e, 0x08, 0x08, 0x80, 0x60, 0x08, 0x08, 0x08, 0x08, 0x40,
+	0x60, 0x10, 0x08, 0x06, 0x3e, 0x49, 0x45, 0x3e, 0x42, 0x7f, 0x40, 0x62,
+	0x51, 0x49, 0x46, 0x21, 0x49, 0x4d, 0x33, 0x1c, 0x12, 0x17, 0x78, 0x27,
+	0x45, 0x45, 0x39, 0x3e, 0x49, 0x49, 0x30, 0x01, 0x71, 0x09, 0x07, 0x36,
+	0x49, 0x49, 0x36, 0x06, 0x49, 0x49, 0x3e, 0x24, 0x80, 0x64, 0x08, 0x14,
+	0x22, 0x14, 0x14, 0x14, 0x14, 0x22, 0x14, 0x08, 0x02, 0x51, 0x09, 0x06,
+	0x3e, 0x41, 0x5d, 0x55, 0x1e, 0x7e, 0x09, 0x09, 0x7e, 0x7f, 0x49, 0x49,
+	0x36, 0x3e, 0x41, 0x41, 0x22, 0x7f, 0x41, 0x41, 0x3e, 0x7f, 0x49, 0x49,
+	0x41, 0x7f, 0x09, 0x09, 0x01, 0x3e, 0x41, 0x49, 0x7a, 0x7f, 0x08, 0x08,
+	0x7f, 0x41, 0x7f, 0x41, 0x20, 0x40, 0x40, 0x3f, 0x7f, 0x14, 0x22, 0x41,
+	0x7f, 0x40, 0x40, 0x40, 0x7f, 0x02, 0x0c, 0x02, 0x7f, 0x7f, 0x06, 0x18,
+	0x7f, 0x3e, 0x41, 0x41, 0x3e, 0x7f, 0x09, 0x09, 0x06, 0x3e, 0x41, 0x21,
+	0x5e, 0x7f, 0x09, 0x19, 0x66, 0x46, 0x49, 0x49, 0x31, 0x01, 0x01, 0x7f,
+	0x01, 0x01, 0x3f, 0x40, 0x40, 0x3f, 0x0f, 0x30, 0x40, 0x30, 0x0f, 0x3f,
+	0x40, 0x38, 0x40, 0x3f, 0x63, 0x14, 0x08, 0x14, 0x63, 0x03, 0x04, 0x78,
+	0x04, 0x03, 0x71, 0x49, 0x45, 0x43, 0x7f, 0x41, 0x06, 0x08, 0x10, 0x60,
+	0x41, 0x7f, 0x02, 0x01, 0x02, 0x80, 0x80, 0x80, 0x80, 0x01, 0x02, 0x20,
+	0x54, 0x54, 0x78, 0x7f, 0x44, 0x44, 0x38, 0x38, 0x44, 0x44, 0x38, 0x44,
+	0x44, 0x7f, 0x38, 0x54, 0x54, 0x58, 0x7e, 0x05, 0x05, 0x18, 0xa4, 0xa4,
+	0x7c, 0x7f, 0x04, 0x04, 0x78, 0x7d, 0x80, 0x7d, 0x7f, 0x10, 0x28, 0x44,
+	0x3f, 0x40, 0x7c, 0x04, 0x78, 0x04, 0x78, 0x7c, 0x04, 0x04, 0x78, 0x38,
+	0x44, 0x44, 0x38, 0xfc, 0x24, 0x24, 0x18, 0x18, 0x24, 0x24, 0xfc, 0x7c,
+	0x08, 0x04, 0x48, 0x54, 0x54, 0x24, 0x3f, 0x44, 0x44, 0x3c, 0x40, 0x40,
+	0x7c, 0x0c, 0x30, 0x40, 0x30, 0x0c, 0x3c, 0x40, 0x30, 0x40, 0x3c, 0x6c,
+	0x10, 0x10, 0x6c, 0x1c, 0xa0, 0xa0, 0x7c, 0x64, 0x54, 0x4c, 0x44, 0x08,
+	0x36, 0x41, 0x7f, 0x41, 0x36, 0x08, 0x08, 0x04, 0x08, 0x04,
+};
+
+static PROGMEM const uint16_t font8b_offs[96] = {
+	  0,   3,   5,   9,  15,  21,  27,  33,
+	 35,  38,  41,  47,  53,  56,  61,  63,
+	 68,  73,  77,  82,  87,  92,  97, 102,
+	107, 112, 117, 119, 122, 126, 131, 135,
+	140, 146, 151, 156, 161, 166, 171, 176,
+	181, 186, 190, 195, 200, 205, 211, 216,
+	221, 226, 231, 236, 241, 247, 252, 258,
+	264, 270, 276, 281, 284, 289, 292, 296,
+	301, 304, 309, 314, 318, 323, 328, 332,
+	337, 342, 344, 347, 352, 355, 361, 366,
+	371, 376, 381, 385, 390, 394, 399, 405,
+	411, 416, 421, 426, 430, 432, 436, 441,
+};
+
+static PROGMEM const uint8_t font8b_cols[441] = {
+	0x00, 0x00, 0x00, 0x5f, 0x5f, 0x03, 0x03, 0x03, 0x03, 0x14, 0x7f, 0x7f,
+	0x7f, 0x7f, 0x14, 0x24, 0x2e, 0x7f, 0x7f, 0x3a, 0x12, 0x23, 0x33, 0x1b,
+	0x6c, 0x66, 0x62, 0x36, 0x7f, 0x5d, 0x77, 0x72, 0x50, 0x03, 0x03, 0x3e,
+	0x7f, 0x41, 0x41, 0x7f, 0x3e, 0x14, 0x1c, 0x3e, 0x3e, 0x1c, 0x14, 0x08,
+	0x08, 0x3e, 0x3e, 0x08, 0x08, 0x80, 0xe0, 0x60, 0x08, 0x08, 0x08, 0x08,
+	0x08, 0x40, 0x40, 0x60, 0x70, 0x18, 0x0e, 0x06, 0x3e, 0x7f, 0x4d, 0x7f,
+	0x3e, 0x42, 0x7f, 0x7f, 0x40, 0x62, 0x73, 0x59, 0x4f, 0x46, 0x21, 0x69,
+	0x4d, 0x7f, 0x33, 0x1c, 0x1e, 0x17, 0x7f, 0x78, 0x27, 0x67, 0x45, 0x7d,
+	0x39, 0x3e, 0x7f, 0x49, 0x79, 0x30, 0x01, 0x71, 0x79, 0x0f, 0x07, 0x36,
+	0x7f, 0x49, 0x7f, 0x36, 0x06, 0x4f, 0x49, 0x7f, 0x3e, 0x24, 0x24, 0x80,
+	0xe4, 0x64, 0x08, 0x1c, 0x36, 0x22, 0x14, 0x14, 0x14, 0x14, 0x14, 0x22,
+	0x36, 0x1c, 0x08, 0x02, 0x53, 0x59, 0x0f, 0x06, 0x3e, 0x7f, 0x5d, 0x5d,
+	0x5f, 0x1e, 0x7e, 0x7f, 0x09, 0x7f, 0x7e, 0x7f, 0x7f, 0x49, 0x7f, 0x36,
+	0x3e, 0x7f, 0x41, 0x63, 0x22, 0x7f, 0x7f, 0x41, 0x7f, 0x3e, 0x7f, 0x7f,
+	0x49, 0x49, 0x41, 0x7f, 0x7f, 0x09, 0x09, 0x01, 0x3e, 0x7f, 0x49, 0x7b,
+	0x7a, 0x7f, 0x7f, 0x08, 0x7f, 0x7f, 0x41, 0x7f, 0x7f, 0x41, 0x20, 0x60,
+	0x40, 0x7f, 0x3f, 0x7f, 0x7f, 0x36, 0x63, 0x41, 0x7f, 0x7f, 0x40, 0x40,
+	0x40, 0x7f, 0x7f, 0x0e, 0x0e, 0x7f, 0x7f, 0x7f, 0x7f, 0x1e, 0x7f, 0x7f,
+	0x3e, 0x7f, 0x41, 0x7f, 0x3e, 0x7f, 0x7f, 0x09, 0x0f, 0x06, 0x3e, 0x7f,
+	0x61, 0x7f, 0x5e, 0x7f, 0x7f, 0x19, 0x7f, 0x66, 0x46, 0x4f, 0x49, 0x79,
+	0x31, 0x01, 0x01, 0x7f, 0x7f, 0x01, 0x01, 0x3f, 0x7f, 0x40, 0x7f, 0x3f,
+	0x0f, 0x3f, 0x70, 0x70, 0x3f, 0x0f, 0x3f, 0x7f, 0x78, 0x78, 0x7f, 0x3f,
+	0x63, 0x77, 0x1c, 0x1c, 0x77, 0x63, 0x03, 0x07, 0x7c, 0x7c, 0x07, 0x03,
+	0x71, 0x79, 0x4d, 0x47, 0x43, 0x7f, 0x7f, 0x41, 0x06, 0x0e, 0x18, 0x70,
+	0x60, 0x41, 0x7f, 0x7f, 0x02, 0x03, 0x03, 0x02, 0x80, 0x80, 0x80, 0x80,
+	0x80, 0x01, 0x03, 0x02, 0x20, 0x74, 0x54, 0x7c, 0x78, 0x7f, 0x7f, 0x44,
+	0x7c, 0x38, 0x38, 0x7c, 0x44, 0x44, 0x38, 0x7c, 0x44, 0x7f, 0x7f, 0x38,
+	0x7c, 0x54, 0x5c, 0x58, 0x7e, 0x7f, 0x05, 0x05, 0x18, 0xbc, 0xa4, 0xfc,
+	0x7c, 0x7f, 0x7f, 0x04, 0x7c, 0x78, 0x7d, 0x7d, 0x80, 0xfd, 0x7d, 0x7f,
+	0x7f, 0x38, 0x6c, 0x44, 0x3f, 0x7f, 0x40, 0x7c, 0x7c, 0x7c, 0x7c, 0x7c,
+	0x78, 0x7c, 0x7c, 0x04, 0x7c, 0x78, 0x38, 0x7c, 0x44, 0x7c, 0x38, 0xfc,
+	0xfc, 0x24, 0x3c, 0x18, 0x18, 0x3c, 0x24, 0xfc, 0xfc, 0x7c, 0x7c, 0x0c,
+	0x04, 0x48, 0x5c, 0x54, 0x74, 0x24, 0x3f, 0x7f, 0x44, 0x44, 0x3c, 0x7c,
+	0x40, 0x7c, 0x7c, 0x0c, 0x3c, 0x70, 0x70, 0x3c, 0x0c, 0x3c, 0x7c, 0x70,
+	0x70, 0x7c, 0x3c, 0x6c, 0x7c, 0x10, 0x7c, 0x6c, 0x1c, 0xbc, 0xa0, 0xfc,
+	0x7c, 0x64, 0x74, 0x5c, 0x4c, 0x44, 0x08, 0x3e, 0x77, 0x41, 0x7f, 0x7f,
+	0x41, 0x77, 0x3e, 0x08, 0x08, 0x0c, 0x0c, 0x0c, 0x04,
+};
@@ -0,0 +1,300 @@
+#include "gfx.h"
+#include "lcd_hardware.h"
+#include "protocol.h"
+#include "scroll.h"
+#include <avr/pgmspace.h>
+
+#include "font8.h" /* generated by mkfont.py */
+
+struct font {
+	uint8_t height, first, last, spacing;
+	const uint16_t *offs; /* PROGMEM, glyph c is cols[offs[c]..offs[c+1]) */
+	const uint8_t *cols;  /* PROGMEM, one byte per column, bit 0 = top */
+};
+
+/* TEXT_FONT(n) */
+static const struct font fonts[] = {
+	{ FONT8_HEIGHT, FONT8_FIRST, FONT8_LAST, FONT8_SPACING,
+		font8_offs, font8_cols },
+	{ FONT8_HEIGHT, FONT8_FIRST, FONT8_LAST, FONT8_SPACING,
+		font8b_offs, font8b_cols },
+};
+
+#define NFONTS (sizeof(fonts)/sizeof(fonts[0]))
+
+/* the part of one pixel line that is being drawn, read-modify-write */
+static uint8_t gfx_buf[LCD_GRAPHIC_COLS];
+
+/* n bytes of line y from byte b on; the addresses come from scroll.c,
+   a scrolling plane has each line twice */
+static void
+gfx_buf_read(uint8_t y,uint8_t b,uint8_t n){
+	uint8_t i;
+	lcd_command_long(CMD_ADDRESS_POINTER,scroll_addr(SCROLL_GRAPHICS,y) + b);
+	lcd_command(CMD_AUTO_READ);
+	for(i=0;i<n;i++)
+		lcd_auto_read(&gfx_buf[i]);
+	lcd_auto_reset();
+}
+
+static void
+gfx_buf_write_at(uint16_t addr,uint8_t n){
+	uint8_t i;
+	lcd_command_long(CMD_ADDRESS_POINTER,addr);
+	lcd_command(CMD_AUTO_WRITE);
+	for(i=0;i<n;i++)
+		lcd_auto_write(gfx_buf[i]);
+	lcd_auto_reset();
+}
+
+static void
+gfx_buf_write(uint8_t y,uint8_t b,uint8_t n){
+	uint16_t twin = scroll_twin(SCROLL_GRAPHICS,y);
+	gfx_buf_write_at(scroll_addr(SCROLL_GRAPHICS,y) + b,n);
+	if(twin)
+		gfx_buf_write_at(twin + b,n);
+}
+
+/* ---------- primitives ---------- */
+
+/* where gfx_pixel() left the address pointer, only valid within one
+   primitive; everything else moves it */
+#define GFX_ADP_UNKNOWN 0xffff
+static uint16_t gfx_adp;
+
+/* one pixel of the byte at addr; XOR reads it from there */
+static void
+gfx_bit(uint16_t addr,uint8_t bit,uint8_t mode){
+	uint8_t d;
+
+	if(addr != gfx_adp){
+		lcd_command_long(CMD_ADDRESS_POINTER,addr);
+		gfx_adp = addr;
+	}
+	if(mode == DRAW_XOR){ /* no bit toggle command */
+		lcd_command_read(CMD_DATA_READ,&d);
+		lcd_command_1(CMD_DATA_WRITE,d ^ (1 << bit));
+	} else if(mode == DRAW_SET)
+		lcd_command(CMD_BIT_SET | bit);
+	else
+		lcd_command(CMD_BIT_RESET | bit);
+}
+
+static void
+gfx_pixel(uint8_t x,uint8_t y,uint8_t mode){
+	uint16_t twin;
+	uint8_t b, bit;
+
+	if(x >= LCD_WIDTH || y >= LCD_HEIGHT)
+		return;
+	b = x / LCD_PIXELS_PER_BYTE;
+	bit = LCD_PIXELS_PER_BYTE - 1 - x % LCD_PIXELS_PER_BYTE;
+	gfx_bit(scroll_addr(SCROLL_GRAPHICS,y) + b,bit,mode);
+	if((twin = scroll_twin(SCROLL_GRAPHICS,y)))
+		gfx_bit(twin + b,bit,mode);
+}
+
+void
+gfx_plot(uint8_t x,uint8_t y,uint8_t mode){
+	gfx_adp = GFX_ADP_UNKNOWN;
+	gfx_pixel(x,y,mode);
+}
+
+void
+gfx_hline(uint8_t x0,uint8_t x1,uint8_t y,uint8_t mode){
+	uint8_t b0, n, i, m, m0, m1;
+
+	if(x0 > x1){
+		m = x0;
+		x0 = x1;
+		x1 = m;
+	}
+	if(x0 >= LCD_WIDTH || y >= LCD_HEIGHT)
+		return;
+	if(x1 >= LCD_WIDTH)
+		x1 = LCD_WIDTH - 1;
+
+	b0 = x0 / LCD_PIXELS_PER_BYTE;
+	n = x1 / LCD_PIXELS_PER_BYTE - b0 + 1;
+	m0 = 0x3f >> (x0 % LCD_PIXELS_PER_BYTE); /* x0.. in the first byte */
+	m1 = (0x3f << (LCD_PIXELS_PER_BYTE - 1 - x1 % LCD_PIXELS_PER_BYTE))
+		& 0x3f;                          /* ..x1 in the last one */
+
+	/* read-modify-write, unless whole bytes are set or cleared */
+	if(mode == DRAW_XOR || m0 != 0x3f || m1 != 0x3f)
+		gfx_buf_read(y,b0,n);
+	for(i=0;i<n;i++){
+		m = 0x3f;
+		if(i == 0)
+			m &= m0;
+		if(i == n-1)
+			m &= m1;
+		if(mode == DRAW_XOR)
+			gfx_buf[i] ^= m;
+		else if(mode == DRAW_SET)
+			gfx_buf[i] |= m;
+		else
+			gfx_buf[i] &= ~m;
+	}
+	gfx_buf_write(y,b0,n);
+}
+
+void
+gfx_vline(uint8_t x,uint8_t y0,uint8_t y1,uint8_t mode){
+	uint8_t y;
+
+	if(y0 > y1){
+		y = y0;
+		y0 = y1;
+		y1 = y;
+	}
+	if(y1 >= LCD_HEIGHT)
+		y1 = LCD_HEIGHT - 1;
+	gfx_adp = GFX_ADP_UNKNOWN;
+	for(y=y0;y<=y1;y++)
+		gfx_pixel(x,y,mode);
+}
+
+/* Bresenham, pixel by pixel; pixels in the same byte share the address
+   set */
+void
+gfx_line(uint8_t x0,uint8_t y0,uint8_t x1,uint8_t y1,uint8_t mode){
+	int16_t dx, dy, err, e2;
+	int8_t sx, sy;
+
+	if(y0 == y1){
+		gfx_hline(x0,x1,y0,mode);
+		return;
+	}
+	if(x0 == x1){
+		gfx_vline(x0,y0,y1,mode);
+		return;
+	}
+	dx = x1 > x0 ? x1 - x0 : x0 - x1;
+	sx = x1 > x0 ? 1 : -1;
+	dy = y1 > y0 ? y0 - y1 : y1 - y0; /* -|dy| */
+	sy = y1 > y0 ? 1 : -1;
+	err = dx + dy;
+
+	gfx_adp = GFX_ADP_UNKNOWN;
+	for(;;){
+		gfx_pixel(x0,y0,mode);
+		if(x0 == x1 && y0 == y1)
+			break;
+		e2 = 2 * err;
+		if(e2 >= dy){
+			err += dy;
+			x0 += sx;
+		}
+		if(e2 <= dx){
+			err += dx;
+			y0 += sy;
+		}
+	}
+}
+
+/* outline, each pixel drawn once, so XOR works */
+void
+gfx_rect(uint8_t x0,uint8_t y0,uint8_t x1,uint8_t y1,uint8_t mode){
+	uint8_t t;
+
+	if(y0 > y1){
+		t = y0;
+		y0 = y1;
+		y1 = t;
+	}
+	gfx_hline(x0,x1,y0,mode);
+	if(y1 == y0)
+		return;
+	gfx_hline(x0,x1,y1,mode);
+	if(y1 - y0 < 2)
+		return;
+	gfx_vline(x0,y0+1,y1-1,mode);
+	if(x1 != x0)
+		gfx_vline(x1,y0+1,y1-1,mode);
+}
+
+void
+gfx_fill(uint8_t x0,uint8_t y0,uint8_t x1,uint8_t y1,uint8_t mode){
+	uint8_t y;
+
+	if(y0 > y1){
+		y = y0;
+		y0 = y1;
+		y1 = y;
+	}
+	if(y1 >= LCD_HEIGHT)
+		y1 = LCD_HEIGHT - 1;
+	for(y=y0;y<=y1;y++)
+		gfx_hline(x0,x1,y,mode);
+}
+
+/* ---------- text ---------- */
+
+/* glyph of c, *w = its width without spacing */
+static uint16_t
+gfx_glyph(const struct font *f,uint8_t c,uint8_t *w){
+	uint16_t o;
+	if(c < f->first || c > f->last)
+		c = '?';
+	c -= f->first;
+	o = pgm_read_word(&f->offs[c]);
+	*w = pgm_read_word(&f->offs[c+1]) - o;
+	return o;
+}
+
+void
+gfx_text(uint8_t x,uint8_t y,uint8_t flags,const uint8_t *s,uint8_t len){
+	const struct font *f = &fonts[0];
+	uint8_t mode = flags & DRAW_MODE, opaque = flags & DRAW_OPAQUE;
+	uint8_t r, i, k, w, gw, b, n, mask, on, *p;
+	uint16_t o, width = 0;
+
+	if((flags >> 4) < NFONTS)
+		f = &fonts[flags >> 4];
+	if(x >= LCD_WIDTH || y >= LCD_HEIGHT)
+		return;
+
+	for(i=0;i<len;i++){
+		gfx_glyph(f,s[i],&gw);
+		width += gw + f->spacing;
+	}
+	if(width > LCD_WIDTH - x)
+		width = LCD_WIDTH - x;
+	if(!width)
+		return;
+	w = width;
+	b = x / LCD_PIXELS_PER_BYTE;
+	n = (x + w - 1) / LCD_PIXELS_PER_BYTE - b + 1;
+
+	/* line by line, each one read, drawn and written back in auto mode;
+	   the read is skipped if every pixel of the bytes gets replaced */
+	for(r=0;r<f->height && y+r < LCD_HEIGHT;r++){
+		if(!opaque || mode == DRAW_XOR || x % LCD_PIXELS_PER_BYTE ||
+		   (x + w) % LCD_PIXELS_PER_BYTE)
+			gfx_buf_read(y+r,b,n);
+		p = gfx_buf;
+		mask = 0x20 >> (x % LCD_PIXELS_PER_BYTE);
+		width = w;
+		for(i=0;i<len && width;i++){
+			o = gfx_glyph(f,s[i],&gw);
+			for(k=0;k < gw + f->spacing && width;k++,width--){
+				on = k < gw && (pgm_read_byte(&f->cols[o+k]) >> r) & 1;
+				if(mode == DRAW_XOR){
+					if(on)
+						*p ^= mask;
+				} else if(on || opaque){
+					if(on == (mode == DRAW_SET))
+						*p |= mask;
+					else
+						*p &= ~mask;
+				}
+				if(!(mask >>= 1)){
+					mask = 0x20;
+					p++;
+				}
+			}
+		}
+		gfx_buf_write(y+r,b,n);
+	}
+}
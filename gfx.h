@@ -0,0 +1,33 @@
+#ifndef GFX_H
+#define GFX_H
+
+#include <stdint.h>
+
+/* drawing into the graphics plane, 6 pixels per byte, leftmost pixel in
+   bit 5 (see lcd_hardware.h) */
+
+#define GFX_TEXT_MAX 48 /* chars per ^N, the rest is dropped */
+
+/* draw len chars of s with the top left corner of the first glyph at
+   pixel x,y. flags: DRAW_* mode, DRAW_OPAQUE and TEXT_FONT(n), see
+   protocol.h. Clipped at the right and bottom edge. Leaves the address
+   pointer somewhere in the graphics plane. */
+extern void gfx_text(uint8_t x,uint8_t y,uint8_t flags,
+	const uint8_t *s,uint8_t len);
+
+/* primitives, mode DRAW_SET, DRAW_XOR or DRAW_CLEAR (protocol.h).
+   Coordinates are inclusive and may come in either order, whatever is
+   off screen is clipped. Single pixels are set with the controller's
+   bit set/reset, spans of a line are written in auto mode. All of them
+   move the address pointer. */
+extern void gfx_plot(uint8_t x,uint8_t y,uint8_t mode);
+extern void gfx_hline(uint8_t x0,uint8_t x1,uint8_t y,uint8_t mode);
+extern void gfx_vline(uint8_t x,uint8_t y0,uint8_t y1,uint8_t mode);
+extern void gfx_line(uint8_t x0,uint8_t y0,uint8_t x1,uint8_t y1,
+	uint8_t mode);
+extern void gfx_rect(uint8_t x0,uint8_t y0,uint8_t x1,uint8_t y1,
+	uint8_t mode);
+extern void gfx_fill(uint8_t x0,uint8_t y0,uint8_t x1,uint8_t y1,
+	uint8_t mode);
+
+#endif
@@ -0,0 +1,114 @@
+/* evbench: sustained throughput and frame rate to an everavr display
+ *
+ *   evbench [-b baud] [-n frames] [-p] [-f] device
+ *
+ * Sends n full graphics frames (^C to LCD_GRAPHIC_BASE, then the 2560
+ * bytes with ^K, or ^L packed with -p), alternating between two
+ * patterns so every frame really changes the display, and reports
+ * KB/s on the wire and frames per second. device and -b are as for
+ * evsend, "usb" picks the first everavr on the bus (vendor stream
+ * requests).
+ * Ends with a ^B/^D round trip on serial ports, so the numbers include
+ * the firmware catching up with the data. -f draws each frame into the
+ * hidden page and flips (^X), no tearing.
+ */
+
+#include "everavr.h"
+#include "../protocol.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <system_error>
+
+#define GRAPHIC_BASE 0x0140 /* lcd_hardware.h */
+#define FRAME_SIZE   0x0a00
+
+/* 4x4 checkerboard, inverted by phase; packs about 1:5 */
+static void
+make_frame(uint8_t *buf,int phase){
+	for(int y=0;y<64;y++)
+		for(int x=0;x<40;x++)
+			buf[y*40+x] = ((x/10 + y/16 + phase) & 1) ? 0x3f : 0x00;
+}
+
+int
+main(int argc,char **argv){
+	unsigned baud = 0;
+	int frames = 100, packed = 0, flip = 0, opt;
+	static uint8_t frame[2][FRAME_SIZE];
+
+	while((opt = getopt(argc,argv,"b:n:pf")) != -1){
+		switch(opt){
+		case 'b':
+			baud = strtoul(optarg,NULL,0);
+			break;
+		case 'n':
+			frames = atoi(optarg);
+			break;
+		case 'p':
+			packed = 1;
+			break;
+		case 'f':
+			flip = 1;
+			break;
+		default:
+			optind = argc;
+		}
+	}
+	if(optind+1 != argc || frames <= 0){
+		fprintf(stderr,"usage: %s [-b baud] [-n frames] [-p] [-f] device\n",
+			argv[0]);
+		return 1;
+	}
+	make_frame(frame[0],0);
+	make_frame(frame[1],1);
+
+	try {
+		std::unique_ptr<everavr::transport> t =
+			everavr::open_transport(argv[optind]);
+		everavr::tty_transport *tty =
+			dynamic_cast<everavr::tty_transport *>(t.get());
+		everavr::client c(std::move(t));
+		unsigned got = c.baud(baud);
+		if(got && baud && got != baud)
+			fprintf(stderr,"%s: no %u bps, staying at %u\n",argv[0],
+				baud,got);
+
+		auto t0 = std::chrono::steady_clock::now();
+		if(flip)
+			c.page(PAGE_BACK);
+		for(int i=0;i<frames;i++){
+			c.addr(GRAPHIC_BASE);
+			if(packed)
+				c.packed(frame[i&1],FRAME_SIZE);
+			else
+				c.bulk(frame[i&1],FRAME_SIZE);
+			if(flip)
+				c.page(PAGE_FLIP | PAGE_BACK);
+		}
+		if(flip)
+			c.page(0);
+		if(tty){
+			uint8_t ping[2] = { 0x02, 0x5a }, b = 0; /* ^B 'Z' */
+			c.submit(ping,2);
+			c.flush();
+			while(read(tty->fileno(),&b,1) == 1 && b != 0x5a)
+				;
+		} else
+			c.flush();
+		double secs = std::chrono::duration<double>(
+			std::chrono::steady_clock::now() - t0).count();
+
+		everavr::stats st = c.get_stats();
+		printf("%d frames, %lu bytes in %lu units, %.3f s: "
+			"%.1f KB/s, %.1f frames/s, %lu errors\n",
+			frames,st.sent,st.units,secs,
+			st.sent / secs / 1024.0,frames / secs,st.errors);
+		return st.errors ? 1 : 0;
+	} catch(std::system_error &e){
+		fprintf(stderr,"%s: %s\n",argv[0],e.what());
+		return 1;
+	}
+}
@@ -0,0 +1,701 @@
+#include "everavr.h"
+
+extern "C" {
+#include "../protocol.h"
+}
+
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <linux/hidraw.h>
+#include <linux/usbdevice_fs.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <system_error>
+
+namespace everavr {
+
+/* ---------- transports ---------- */
+
+transport::~transport(){
+}
+
+static int
+open_or_throw(const std::string &dev,int flags){
+	int fd = ::open(dev.c_str(),flags);
+	if(fd < 0)
+		throw std::system_error(errno,std::generic_category(),dev);
+	return fd;
+}
+
+hidraw_transport::hidraw_transport(const std::string &dev){
+	fd = open_or_throw(dev,O_RDWR);
+}
+
+hidraw_transport::~hidraw_transport(){
+	::close(fd);
+}
+
+bool
+hidraw_transport::send(const uint8_t *buf,size_t len){
+	uint8_t rep[1+report_size];
+
+	if(len > report_size){
+		errno = EMSGSIZE;
+		return false;
+	}
+	/* the device has a single feature report without an ID; it takes
+	   whatever length comes, so short reports are not padded */
+	rep[0] = 0;
+	memcpy(rep+1,buf,len);
+	return ioctl(fd,HIDIOCSFEATURE(len+1),rep) >= 0;
+}
+
+/* GET_REPORT until len bytes are in; a short report ends the readback */
+bool
+hidraw_transport::fetch(uint8_t *buf,size_t len){
+	uint8_t rep[1+report_size];
+
+	while(len){
+		rep[0] = 0;
+		int r = ioctl(fd,HIDIOCGFEATURE(sizeof(rep)),rep);
+		if(r < 0)
+			return false;
+		size_t n = r > 1 ? r-1 : 0;
+		if(n > len)
+			n = len;
+		memcpy(buf,rep+1,n);
+		buf += n;
+		len -= n;
+		if(len && n < report_size){
+			errno = EIO;
+			return false;
+		}
+	}
+	return true;
+}
+
+usbfs_transport::usbfs_transport(const std::string &dev){
+	fd = open_or_throw(dev,O_RDWR);
+}
+
+usbfs_transport::~usbfs_transport(){
+	::close(fd);
+}
+
+bool
+usbfs_transport::send(const uint8_t *buf,size_t len){
+	struct usbdevfs_ctrltransfer ct;
+
+	if(len > max_transfer){
+		errno = EMSGSIZE;
+		return false;
+	}
+	memset(&ct,0,sizeof(ct));
+	ct.bRequestType = 0x40; /* vendor, device, host to device */
+	ct.bRequest = USB_RQ_STREAM;
+	ct.wLength = len;
+	ct.timeout = 5000;
+	ct.data = const_cast<uint8_t *>(buf);
+	return ioctl(fd,USBDEVFS_CONTROL,&ct) == (int)len;
+}
+
+bool
+usbfs_transport::fetch(uint8_t *buf,size_t len){
+	struct usbdevfs_ctrltransfer ct;
+
+	while(len){
+		size_t n = len > max_transfer ? max_transfer : len;
+		memset(&ct,0,sizeof(ct));
+		ct.bRequestType = 0xc0; /* vendor, device, device to host */
+		ct.bRequest = USB_RQ_READBACK;
+		ct.wLength = n;
+		ct.timeout = 5000;
+		ct.data = buf;
+		int r = ioctl(fd,USBDEVFS_CONTROL,&ct);
+		if(r < 0)
+			return false;
+		if((size_t)r != n){
+			errno = EIO;
+			return false;
+		}
+		buf += n;
+		len -= n;
+	}
+	return true;
+}
+
+static std::string
+sysfs_attr(const std::string &dir,const char *name){
+	std::ifstream f(dir + "/" + name);
+	std::string s;
+	std::getline(f,s);
+	return s;
+}
+
+std::string
+find_usb(){
+	static const char sysdir[] = "/sys/bus/usb/devices";
+	std::string ret;
+	DIR *d = opendir(sysdir);
+	struct dirent *de;
+
+	if(!d)
+		return ret;
+	while(ret.empty() && (de = readdir(d))){
+		std::string dir = std::string(sysdir) + "/" + de->d_name;
+		if(sysfs_attr(dir,"idVendor") != "16c0"
+		    || sysfs_attr(dir,"idProduct") != "05df"
+		    || sysfs_attr(dir,"product") != "everavr")
+			continue;
+		char path[32];
+		snprintf(path,sizeof(path),"/dev/bus/usb/%03d/%03d",
+			atoi(sysfs_attr(dir,"busnum").c_str()),
+			atoi(sysfs_attr(dir,"devnum").c_str()));
+		ret = path;
+	}
+	closedir(d);
+	return ret;
+}
+
+static speed_t
+tty_speed(unsigned baud){
+	switch(baud){
+	case 9600:    return B9600;
+	case 19200:   return B19200;
+	case 38400:   return B38400;
+	case 57600:   return B57600;
+	case 115200:  return B115200;
+	case 230400:  return B230400;
+#ifdef B460800
+	case 460800:  return B460800;
+	case 500000:  return B500000;
+	case 576000:  return B576000;
+	case 921600:  return B921600;
+	case 1000000: return B1000000;
+	case 1152000: return B1152000;
+#endif
+	}
+	return B0;
+}
+
+bool tty_set_rate(int fd,unsigned baud); /* termios2.cc */
+
+static_assert(reset_baud == BAUD_RESET,"reset_baud out of step");
+
+tty_transport::tty_transport(const std::string &dev,unsigned baud){
+	struct termios tio;
+	speed_t sp = tty_speed(baud);
+
+	fd = open_or_throw(dev,O_RDWR|O_NOCTTY);
+	if(tcgetattr(fd,&tio) < 0){
+		int e = errno;
+		::close(fd);
+		throw std::system_error(e,std::generic_category(),dev);
+	}
+	cfmakeraw(&tio);
+	cfsetispeed(&tio,sp == B0 ? B115200 : sp);
+	cfsetospeed(&tio,sp == B0 ? B115200 : sp);
+	tio.c_cflag |= CLOCAL | CREAD;
+	tio.c_cflag |= CRTSCTS; /* the firmware stops us with RTS on PB3 */
+	tio.c_cflag &= ~CSTOPB;
+	tcsetattr(fd,TCSANOW,&tio);
+	if(sp == B0 && !tty_set_rate(fd,baud)){
+		::close(fd);
+		throw std::system_error(EINVAL,std::generic_category(),
+			dev + ": unsupported baud rate");
+	}
+	send_break();
+}
+
+tty_transport::~tty_transport(){
+	::close(fd);
+}
+
+bool
+tty_transport::send(const uint8_t *buf,size_t len){
+	while(len){
+		ssize_t r = ::write(fd,buf,len);
+		if(r < 0){
+			if(errno == EINTR)
+				continue;
+			return false;
+		}
+		buf += r;
+		len -= r;
+	}
+	return true;
+}
+
+bool
+tty_transport::set_baud(unsigned baud){
+	if(tcdrain(fd) < 0)
+		return false;
+	usleep(1000); /* tcdrain() doesn't see the adapter's FIFO */
+	return tty_set_rate(fd,baud);
+}
+
+/* the firmware takes any framing error at a ^U rate as one, a few
+   characters long will do */
+void
+tty_transport::send_break(){
+	tcdrain(fd);
+	ioctl(fd,TIOCSBRK);
+	usleep(2000);
+	ioctl(fd,TIOCCBRK);
+	usleep(1000);
+	tcflush(fd,TCIFLUSH);
+}
+
+/* the firmware streams ^R at line rate, give up after a second of
+   silence */
+bool
+tty_transport::fetch(uint8_t *buf,size_t len){
+	struct pollfd pfd = { fd, POLLIN, 0 };
+
+	while(len){
+		int r = poll(&pfd,1,1000);
+		if(r < 0 && errno == EINTR)
+			continue;
+		if(r <= 0){
+			if(!r)
+				errno = ETIMEDOUT;
+			return false;
+		}
+		ssize_t n = ::read(fd,buf,len);
+		if(n <= 0)
+			return false;
+		buf += n;
+		len -= n;
+	}
+	return true;
+}
+
+std::unique_ptr<transport>
+open_transport(const std::string &dev,unsigned baud){
+	if(dev.compare(0,11,"/dev/hidraw") == 0)
+		return std::unique_ptr<transport>(new hidraw_transport(dev));
+	if(dev == "usb"){
+		std::string path = find_usb();
+		if(path.empty())
+			throw std::system_error(ENODEV,std::generic_category(),
+				"no everavr on USB");
+		return std::unique_ptr<transport>(new usbfs_transport(path));
+	}
+	if(dev.compare(0,13,"/dev/bus/usb/") == 0)
+		return std::unique_ptr<transport>(new usbfs_transport(dev));
+	return std::unique_ptr<transport>(new tty_transport(dev,baud));
+}
+
+/* ---------- client ---------- */
+
+client::client(std::unique_ptr<transport> t,std::chrono::microseconds d)
+	: tr(std::move(t)), deadline(d),
+	  flushing(false), stopping(false), failed(false), busy(false),
+	  st()
+{
+	worker = std::thread(&client::run,this);
+}
+
+client::~client(){
+	flush();
+	{
+		std::lock_guard<std::mutex> l(mtx);
+		stopping = true;
+	}
+	wake.notify_all();
+	worker.join();
+}
+
+/* background sender: full units at once, the rest after the deadline */
+void
+client::run(){
+	std::unique_lock<std::mutex> l(mtx);
+	std::vector<uint8_t> unit;
+	size_t chunk = tr->chunk();
+
+	for(;;){
+		if(queue.empty()){
+			if(flushing && !busy)
+				idle.notify_all();
+			if(stopping)
+				return;
+			wake.wait(l);
+			continue;
+		}
+		if(queue.size() < chunk && !flushing && !stopping){
+			auto due = oldest + deadline;
+			if(std::chrono::steady_clock::now() < due){
+				wake.wait_until(l,due);
+				continue;
+			}
+		}
+
+		size_t n = queue.size() < chunk ? queue.size() : chunk;
+		unit.assign(queue.begin(),queue.begin()+n);
+		queue.erase(queue.begin(),queue.begin()+n);
+		busy = true;
+		l.unlock();
+		bool ok = tr->send(unit.data(),n);
+		l.lock();
+		busy = false;
+		st.units++;
+		if(ok)
+			st.sent += n;
+		else {
+			st.errors++;
+			failed = true;
+		}
+	}
+}
+
+void
+client::submit(const uint8_t *buf,size_t len){
+	if(!len)
+		return;
+	{
+		std::lock_guard<std::mutex> l(mtx);
+		if(queue.empty())
+			oldest = std::chrono::steady_clock::now();
+		queue.insert(queue.end(),buf,buf+len);
+		st.submitted += len;
+	}
+	wake.notify_one();
+}
+
+bool
+client::flush(){
+	std::unique_lock<std::mutex> l(mtx);
+	bool ok;
+
+	flushing = true;
+	wake.notify_one();
+	idle.wait(l,[this]{ return queue.empty() && !busy; });
+	flushing = false;
+	ok = !failed;
+	failed = false;
+	return ok;
+}
+
+void
+client::set_deadline(std::chrono::microseconds d){
+	{
+		std::lock_guard<std::mutex> l(mtx);
+		deadline = d;
+	}
+	wake.notify_one();
+}
+
+struct stats
+client::get_stats(){
+	std::lock_guard<std::mutex> l(mtx);
+	return st;
+}
+
+/* ---------- command encoders ---------- */
+
+void
+client::text(const std::string &s){
+	std::vector<uint8_t> v;
+	for(unsigned char c : s)
+		if(c >= 0x20)
+			v.push_back(c);
+	submit(v);
+}
+
+void
+client::write(uint8_t b){
+	uint8_t c[2] = { CHAR_WRITE, b };
+	submit(c,2);
+}
+
+void
+client::echo(uint8_t b){
+	uint8_t c[2] = { CHAR_ECHO, b };
+	submit(c,2);
+}
+
+void
+client::addr(uint16_t a){
+	uint8_t c[3] = { CHAR_ADDR, (uint8_t)(a & 0xff), (uint8_t)(a >> 8) };
+	submit(c,3);
+}
+
+void
+client::reset(){
+	uint8_t c = CHAR_RESET;
+	submit(&c,1);
+}
+
+void
+client::mode(uint8_t m){
+	uint8_t c[2] = { CHAR_MODE, m };
+	submit(c,2);
+}
+
+void
+client::display(uint8_t d){
+	uint8_t c[2] = { CHAR_DISP, d };
+	submit(c,2);
+}
+
+void
+client::cursor(uint8_t lines){
+	uint8_t c[2] = { CHAR_CURSOR, (uint8_t)(lines-1) };
+	submit(c,2);
+}
+
+void
+client::bulk(const uint8_t *buf,size_t len){
+	std::vector<uint8_t> v;
+	while(len){
+		size_t n = len > 0xffff ? 0xffff : len;
+		if(n <= 256){ /* ^I is one byte shorter */
+			v.push_back(CHAR_BULK);
+			v.push_back(n & 0xff);
+		} else {
+			v.push_back(CHAR_LBULK);
+			v.push_back(n & 0xff);
+			v.push_back(n >> 8);
+		}
+		v.insert(v.end(),buf,buf+n);
+		buf += n;
+		len -= n;
+	}
+	submit(v);
+}
+
+void
+client::packed(const uint8_t *buf,size_t len){
+	std::vector<uint8_t> v = pack(buf,len);
+	v.insert(v.begin(),CHAR_PACKED);
+	v.push_back(PACK_END);
+	submit(v);
+}
+
+void
+client::plot(uint8_t x,uint8_t y,uint8_t mode){
+	uint8_t c[4] = { CHAR_DRAW, (uint8_t)(DRAW_PLOT | mode), x, y };
+	submit(c,4);
+}
+
+void
+client::hline(uint8_t x0,uint8_t x1,uint8_t y,uint8_t mode){
+	uint8_t c[5] = { CHAR_DRAW, (uint8_t)(DRAW_HLINE | mode), x0, x1, y };
+	submit(c,5);
+}
+
+void
+client::vline(uint8_t x,uint8_t y0,uint8_t y1,uint8_t mode){
+	uint8_t c[5] = { CHAR_DRAW, (uint8_t)(DRAW_VLINE | mode), x, y0, y1 };
+	submit(c,5);
+}
+
+void
+client::line(uint8_t x0,uint8_t y0,uint8_t x1,uint8_t y1,uint8_t mode){
+	uint8_t c[6] = { CHAR_DRAW, (uint8_t)(DRAW_LINE | mode), x0, y0, x1, y1 };
+	submit(c,6);
+}
+
+void
+client::rect(uint8_t x0,uint8_t y0,uint8_t x1,uint8_t y1,uint8_t mode){
+	uint8_t c[6] = { CHAR_DRAW, (uint8_t)(DRAW_RECT | mode), x0, y0, x1, y1 };
+	submit(c,6);
+}
+
+void
+client::fill(uint8_t x0,uint8_t y0,uint8_t x1,uint8_t y1,uint8_t mode){
+	uint8_t c[6] = { CHAR_DRAW, (uint8_t)(DRAW_FILL | mode), x0, y0, x1, y1 };
+	submit(c,6);
+}
+
+void
+client::scroll(uint8_t op,const uint8_t *line){
+	std::vector<uint8_t> v = { CHAR_SCROLL, op };
+	if(line){
+		v[1] |= SCROLL_DATA;
+		v.insert(v.end(),line,line+40);
+	}
+	submit(v);
+}
+
+void
+client::page(uint8_t op){
+	uint8_t c[2] = { CHAR_PAGE, op };
+	submit(c,2);
+}
+
+void
+client::terminal(){
+	uint8_t c = CHAR_TERMINAL;
+	submit(&c,1);
+}
+
+void
+client::tiles(uint8_t slot,const uint8_t *buf,size_t n){
+	while(n){
+		size_t k = n > 256 ? 256 : n;
+		uint8_t c[3] = { CHAR_TILES, slot, (uint8_t)k };
+		std::vector<uint8_t> v(c,c+3);
+		v.insert(v.end(),buf,buf+k*TILE_SIZE);
+		submit(v);
+		slot += k;
+		buf += k*TILE_SIZE;
+		n -= k;
+	}
+}
+
+void
+client::cursor_pos(uint8_t x,uint8_t y){
+	uint8_t c[3] = { CHAR_POS_CURSOR, x, y };
+	submit(c,3);
+}
+
+void
+client::draw_text(uint8_t x,uint8_t y,const std::string &s,uint8_t flags){
+	size_t n = s.size() > 255 ? 255 : s.size();
+	std::vector<uint8_t> v = { CHAR_TEXT, x, y, flags, (uint8_t)n };
+	v.insert(v.end(),s.begin(),s.begin()+n);
+	submit(v);
+}
+
+bool
+client::read(uint16_t addr,uint8_t *buf,size_t len){
+	while(len){
+		size_t n = len > 0xffff ? 0xffff : len;
+		uint8_t c[5] = { CHAR_READ, (uint8_t)(addr & 0xff),
+			(uint8_t)(addr >> 8), (uint8_t)(n & 0xff),
+			(uint8_t)(n >> 8) };
+		submit(c,5);
+		if(!flush())
+			return false;
+		{
+			/* hold off the worker and other submitters, the
+			   firmware doesn't eat input before we have it all */
+			std::lock_guard<std::mutex> l(mtx);
+			if(!tr->fetch(buf,n))
+				return false;
+		}
+		addr += n;
+		buf += n;
+		len -= n;
+	}
+	return true;
+}
+
+/* ^B round trip, true if seq comes back; skips what else is there */
+bool
+client::ping(uint8_t seq){
+	uint8_t b;
+
+	echo(seq);
+	if(!flush())
+		return false;
+	std::lock_guard<std::mutex> l(mtx);
+	for(unsigned i=0;i<16;i++){
+		if(!tr->fetch(&b,1))
+			return false;
+		if(b == seq)
+			return true;
+	}
+	return false;
+}
+
+unsigned
+client::baud(unsigned rate){
+	tty_transport *tty = dynamic_cast<tty_transport *>(tr.get());
+	unsigned long d, got;
+
+	if(!tty)
+		return 0;
+	if(!rate){
+		for(d=2;d<=5;d++)
+			if(baud(BAUD_CLOCK / d) != reset_baud)
+				return BAUD_CLOCK / d;
+		return reset_baud;
+	}
+
+	/* both ends back at reset_baud, whatever happened before */
+	flush();
+	tty->set_baud(reset_baud);
+	tty->send_break();
+
+	d = (BAUD_CLOCK + rate / 2) / rate; /* n + 1 */
+	got = d ? BAUD_CLOCK / d : 0;
+	if(d < 2 || d > BAUD_DEFAULT ||
+	   got * 50 < rate * 49 || got * 50 > rate * 51)
+		return reset_baud; /* not within 2% */
+
+	uint8_t c[2] = { CHAR_BAUD, (uint8_t)(d - 1) };
+	if(ping(0xa5)){ /* the firmware has eaten everything so far */
+		submit(c,2);
+		if(flush() && tty->set_baud(got)){
+			usleep(1000); /* it switches two characters later */
+			tcflush(tty->fileno(),TCIFLUSH);
+			if(ping(0x5a))
+				return got;
+		}
+	}
+	tty->set_baud(reset_baud);
+	tty->send_break();
+	return reset_baud;
+}
+
+/* ---------- packed format, same as pack() in everavr.py ---------- */
+
+static void
+pack_flush(std::vector<uint8_t> &out,std::vector<uint8_t> &lit){
+	if(lit.empty())
+		return;
+	out.push_back(lit.size());
+	out.insert(out.end(),lit.begin(),lit.end());
+	lit.clear();
+}
+
+std::vector<uint8_t>
+pack(const uint8_t *buf,size_t len){
+	std::vector<uint8_t> out, lit;
+	size_t i = 0, n, k;
+
+	while(i < len){
+		uint8_t b = buf[i];
+		for(n=1;i+n < len && buf[i+n] == b;n++)
+			;
+		i += n;
+		if(n < 3){
+			while(n--){
+				lit.push_back(b);
+				if(lit.size() == 0x7f)
+					pack_flush(out,lit);
+			}
+			continue;
+		}
+		pack_flush(out,lit);
+		while(n){
+			if(b == 0){
+				k = n > 0x4000 ? 0x4000 : n;
+				out.push_back(PACK_ZERO | ((k-1) >> 8));
+				out.push_back((k-1) & 0xff);
+			} else if(n == 1){
+				k = 1;
+				lit.push_back(b);
+			} else {
+				k = n > 0x41 ? 0x41 : n;
+				out.push_back(PACK_REPEAT | (k-2));
+				out.push_back(b);
+			}
+			n -= k;
+		}
+	}
+	pack_flush(out,lit);
+	return out;
+}
+
+} // namespace everavr
@@ -0,0 +1,198 @@
+#ifndef EVERAVR_H
+#define EVERAVR_H
+
+/* libeveravr: host side client for the everavr LCD firmware
+ *
+ * Protocol commands (see ../protocol.h) are queued with the non-blocking
+ * submit functions and sent by a background thread. Over USB, queued
+ * bytes are cut into 128 byte HID reports (the report size declared in
+ * everavr.c), so many small commands share one control transfer. A
+ * partial report goes out when flush() is called or when the oldest
+ * queued byte is older than the deadline; full reports go out at once.
+ * With usbfs_transport, units are vendor USB_RQ_STREAM transfers of up
+ * to 4k instead, which saves the per-report overhead.
+ * The firmware parses one continuous byte stream, so commands may
+ * straddle report boundaries.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace everavr {
+
+/* the firmware's serial rate after reset, BAUD_RESET in protocol.h */
+static const unsigned reset_baud = 112500;
+
+/* ---------- transports ---------- */
+
+class transport {
+public:
+	virtual ~transport();
+	/* write len bytes as one unit (one HID report), blocking;
+	   returns false on error, errno is set */
+	virtual bool send(const uint8_t *buf,size_t len) = 0;
+	/* largest unit send() accepts */
+	virtual size_t chunk() const = 0;
+	/* receive len bytes of a ^R readback, blocking; false on error or
+	   timeout */
+	virtual bool fetch(uint8_t *buf,size_t len) = 0;
+};
+
+/* /dev/hidrawN, one SET_REPORT per send() */
+class hidraw_transport : public transport {
+public:
+	static const size_t report_size = 128;
+	explicit hidraw_transport(const std::string &dev);
+	~hidraw_transport();
+	bool send(const uint8_t *buf,size_t len);
+	bool fetch(uint8_t *buf,size_t len);
+	size_t chunk() const { return report_size; }
+private:
+	int fd;
+};
+
+/* /dev/bus/usb/BBB/DDD, one USB_RQ_STREAM control transfer per send();
+   usbfs limits control transfers to a page */
+class usbfs_transport : public transport {
+public:
+	static const size_t max_transfer = 4096;
+	explicit usbfs_transport(const std::string &dev);
+	~usbfs_transport();
+	bool send(const uint8_t *buf,size_t len);
+	bool fetch(uint8_t *buf,size_t len);
+	size_t chunk() const { return max_transfer; }
+private:
+	int fd;
+};
+
+/* serial port, raw 8N1, RTS/CTS handshake; any baud rate the driver
+   takes. Opening sends a break, which gets a firmware left at a ^U rate
+   back to reset_baud */
+class tty_transport : public transport {
+public:
+	tty_transport(const std::string &dev,unsigned baud=reset_baud);
+	~tty_transport();
+	bool send(const uint8_t *buf,size_t len);
+	bool fetch(uint8_t *buf,size_t len);
+	size_t chunk() const { return 4096; }
+	int fileno() const { return fd; }
+	/* after the output so far is out; false on error */
+	bool set_baud(unsigned baud);
+	/* a short break, then drops the input that came in meanwhile */
+	void send_break();
+private:
+	int fd;
+};
+
+/* usbfs path of the first everavr on the bus (VID/PID and product
+   string from usbconfig.h), empty if there is none */
+std::string find_usb();
+
+/* "/dev/hidraw*" -> hidraw_transport, "usb" -> usbfs_transport on
+   find_usb(), "/dev/bus/usb/..." -> usbfs_transport, anything else ->
+   tty_transport; throws std::system_error if the device can't be opened */
+std::unique_ptr<transport> open_transport(const std::string &dev,
+	unsigned baud=reset_baud);
+
+/* ---------- client ---------- */
+
+struct stats {
+	unsigned long submitted;  /* bytes queued */
+	unsigned long sent;       /* bytes on the wire */
+	unsigned long units;      /* reports / write() calls */
+	unsigned long errors;     /* failed send() */
+};
+
+class client {
+public:
+	explicit client(std::unique_ptr<transport> t,
+		std::chrono::microseconds deadline=std::chrono::milliseconds(2));
+	~client(); /* flushes */
+
+	/* queue raw protocol bytes, never blocks */
+	void submit(const uint8_t *buf,size_t len);
+	void submit(const std::vector<uint8_t> &v) { submit(v.data(),v.size()); }
+
+	/* command encoders, all non-blocking */
+	void text(const std::string &s);             /* printable chars */
+	void write(uint8_t b);                       /* ^A */
+	void echo(uint8_t b);                        /* ^B */
+	void addr(uint16_t a);                       /* ^C */
+	void reset();                                /* ^E */
+	void mode(uint8_t m);                        /* ^F */
+	void display(uint8_t d);                     /* ^G */
+	void cursor(uint8_t lines);                  /* ^H */
+	void bulk(const uint8_t *buf,size_t len);    /* ^I / ^K */
+	void packed(const uint8_t *buf,size_t len);  /* ^L, raw data in */
+	/* ^V primitives, mode DRAW_SET/XOR/CLEAR from protocol.h */
+	void plot(uint8_t x,uint8_t y,uint8_t mode=0);
+	void hline(uint8_t x0,uint8_t x1,uint8_t y,uint8_t mode=0);
+	void vline(uint8_t x,uint8_t y0,uint8_t y1,uint8_t mode=0);
+	void line(uint8_t x0,uint8_t y0,uint8_t x1,uint8_t y1,uint8_t mode=0);
+	void rect(uint8_t x0,uint8_t y0,uint8_t x1,uint8_t y1,uint8_t mode=0);
+	void fill(uint8_t x0,uint8_t y0,uint8_t x1,uint8_t y1,uint8_t mode=0);
+	/* ^W, SCROLL_* op from protocol.h; line: the 40 bytes that scroll
+	   in, nullptr clears the new line */
+	void scroll(uint8_t op,const uint8_t *line=nullptr);
+	void page(uint8_t op);                       /* ^X, PAGE_* */
+	/* ^Y, enters or leaves terminal mode; in it, text() takes CR/LF/
+	   BS/TAB and ANSI escapes (../term.h) */
+	void terminal();
+	/* ^O, n tiles of TILE_SIZE bytes into CG RAM for codes slot.. */
+	void tiles(uint8_t slot,const uint8_t *buf,size_t n);
+	void cursor_pos(uint8_t x,uint8_t y);        /* ^P */
+	/* ^N, proportional font into the graphics plane at pixel x,y;
+	   flags DRAW_* | TEXT_FONT(n) from protocol.h, the firmware draws
+	   the first GFX_TEXT_MAX (48) chars */
+	void draw_text(uint8_t x,uint8_t y,const std::string &s,
+		uint8_t flags=0);
+
+	/* read len bytes of display RAM from addr (^R): flushes, then
+	   waits for the answer. Nothing else may be submitted meanwhile,
+	   over USB that would cancel the readback. false on error */
+	bool read(uint16_t addr,uint8_t *buf,size_t len);
+
+	/* serial port only: switch to rate with ^U and confirm it with a
+	   ^B round trip, or go back to reset_baud if that fails. rate 0 tries
+	   the fastest the firmware does first (1.125M, 750k, 562.5k,
+	   450k). Returns the rate in use, 0 if the transport isn't a tty.
+	   Flushes; nothing else may be submitted meanwhile */
+	unsigned baud(unsigned rate=0);
+
+	/* send everything queued so far and wait until it's on the wire;
+	   returns false if any send() failed since the last flush() */
+	bool flush();
+
+	void set_deadline(std::chrono::microseconds d);
+	struct stats get_stats();
+
+private:
+	void run();
+	bool ping(uint8_t seq);
+
+	std::unique_ptr<transport> tr;
+	std::chrono::microseconds deadline;
+
+	std::mutex mtx;
+	std::condition_variable wake, idle;
+	std::vector<uint8_t> queue;
+	std::chrono::steady_clock::time_point oldest;
+	bool flushing, stopping, failed, busy;
+	struct stats st;
+	std::thread worker;
+};
+
+/* packed format (protocol.h) encoder, without the trailing PACK_END */
+std::vector<uint8_t> pack(const uint8_t *buf,size_t len);
+
+} // namespace everavr
+
+#endif
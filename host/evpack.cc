@@ -0,0 +1,106 @@
+/* evpack: images to graphics plane contents, as a stream filter
+ *
+ *   evpack [-d t|o|f] [-l level] [-i] [-r WxH] [-c] [file]
+ *
+ * Reads PBM (P1, P4) or PGM (P2, P5) pictures one after the other from
+ * file or stdin, or raw 8 bit gray frames of WxH bytes with -r, and
+ * writes 2560 bytes of packed plane per picture to stdout (see image.h).
+ * Dithering: -d t threshold at level (-l, default 128), o ordered, f
+ * Floyd-Steinberg (default); -i inverts. With -c each plane is wrapped
+ * in ^C LCD_GRAPHIC_BASE + ^K, e.g. "mkframes | evpack -c | evsend dev".
+ * Prints frames and time per frame on stderr when done.
+ */
+
+#include "image.h"
+#include "../protocol.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <stdexcept>
+
+#define GRAPHIC_BASE 0x0140 /* lcd_hardware.h */
+
+int
+main(int argc,char **argv){
+	everavr::dither_method method = everavr::dither_floyd;
+	unsigned level = 128, rw = 0, rh = 0;
+	int invert = 0, cmds = 0, opt;
+	FILE *in = stdin;
+
+	while((opt = getopt(argc,argv,"d:l:ir:c")) != -1){
+		switch(opt){
+		case 'd':
+			if(optarg[0] == 't')
+				method = everavr::dither_threshold;
+			else if(optarg[0] == 'o')
+				method = everavr::dither_ordered;
+			else if(optarg[0] == 'f')
+				method = everavr::dither_floyd;
+			else
+				optind = argc;
+			break;
+		case 'l':
+			level = strtoul(optarg,NULL,0);
+			break;
+		case 'i':
+			invert = 1;
+			break;
+		case 'r':
+			if(sscanf(optarg,"%ux%u",&rw,&rh) != 2 || !rw || !rh)
+				optind = argc;
+			break;
+		case 'c':
+			cmds = 1;
+			break;
+		default:
+			optind = argc;
+		}
+	}
+	if(optind+1 < argc || level > 255){
+		fprintf(stderr,"usage: %s [-d t|o|f] [-l level] [-i] [-r WxH] "
+			"[-c] [file]\n",argv[0]);
+		return 1;
+	}
+	if(optind < argc && !(in = fopen(argv[optind],"rb"))){
+		perror(argv[optind]);
+		return 1;
+	}
+
+	everavr::packer p(method,level,invert);
+	everavr::image img;
+	static uint8_t plane[everavr::packer::size];
+	static const uint8_t head[] = {
+		CHAR_ADDR, GRAPHIC_BASE & 0xff, GRAPHIC_BASE >> 8,
+		CHAR_LBULK, everavr::packer::size & 0xff,
+		everavr::packer::size >> 8
+	};
+	unsigned long frames = 0;
+	std::chrono::steady_clock::duration busy(0);
+
+	try {
+		while(rw ? everavr::read_raw(in,rw,rh,img) :
+		      everavr::read_pnm(in,img)){
+			auto t0 = std::chrono::steady_clock::now();
+			p.pack(img,plane);
+			busy += std::chrono::steady_clock::now() - t0;
+			if((cmds && fwrite(head,1,sizeof(head),stdout) !=
+			    sizeof(head)) ||
+			   fwrite(plane,1,sizeof(plane),stdout) != sizeof(plane)){
+				perror("stdout");
+				return 1;
+			}
+			frames++;
+		}
+	} catch(std::runtime_error &e){
+		fprintf(stderr,"%s: frame %lu: %s\n",argv[0],frames,e.what());
+		return 1;
+	}
+	fflush(stdout);
+	fprintf(stderr,"%lu frames, %.1f us per frame\n",frames,
+		frames ? std::chrono::duration<double,std::micro>(busy).count() /
+		frames : 0.0);
+	return 0;
+}
@@ -0,0 +1,84 @@
+/* evsend: copy stdin (or files) to an everavr display through libeveravr
+ *
+ *   evsend [-b baud] [-d deadline_us] device [file...]
+ *
+ * e.g. "mkframe | evsend /dev/hidraw3"; prints transfer statistics on
+ * stderr when done. On a serial port the link starts at 112500 and goes
+ * to baud with ^U (protocol.h) if the firmware confirms it; 0, the
+ * default, takes the fastest that works.
+ */
+
+#include "everavr.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <system_error>
+
+static int
+copy(everavr::client &c,FILE *f){
+	uint8_t buf[4096];
+	size_t n;
+	while((n = fread(buf,1,sizeof(buf),f)) > 0)
+		c.submit(buf,n);
+	return ferror(f) ? 1 : 0;
+}
+
+int
+main(int argc,char **argv){
+	unsigned baud = 0;
+	long deadline = 2000;
+	int opt, ret = 0;
+
+	while((opt = getopt(argc,argv,"b:d:")) != -1){
+		switch(opt){
+		case 'b':
+			baud = strtoul(optarg,NULL,0);
+			break;
+		case 'd':
+			deadline = strtol(optarg,NULL,0);
+			break;
+		default:
+			optind = argc;
+		}
+	}
+	if(optind >= argc){
+		fprintf(stderr,"usage: %s [-b baud] [-d deadline_us] "
+			"device [file...]\n",argv[0]);
+		return 1;
+	}
+
+	try {
+		everavr::client c(everavr::open_transport(argv[optind]),
+			std::chrono::microseconds(deadline));
+		unsigned got = c.baud(baud);
+		if(got && baud && got != baud)
+			fprintf(stderr,"%s: no %u bps, staying at %u\n",argv[0],
+				baud,got);
+
+		if(optind+1 == argc)
+			ret |= copy(c,stdin);
+		for(int i=optind+1;i<argc;i++){
+			FILE *f = fopen(argv[i],"rb");
+			if(!f){
+				perror(argv[i]);
+				ret = 1;
+				continue;
+			}
+			ret |= copy(c,f);
+			fclose(f);
+		}
+		if(!c.flush()){
+			perror(argv[optind]);
+			ret = 1;
+		}
+		everavr::stats st = c.get_stats();
+		fprintf(stderr,"%lu bytes in %lu units, %lu errors\n",
+			st.sent,st.units,st.errors);
+	} catch(std::system_error &e){
+		fprintf(stderr,"%s: %s\n",argv[0],e.what());
+		return 1;
+	}
+	return ret;
+}
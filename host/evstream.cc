@@ -0,0 +1,269 @@
+/* evstream: live frames to an everavr display, changed rows only
+ *
+ *   evstream [-b baud] [-d t|o|f] [-l level] [-i] [-r WxH | -P] [-v]
+ *            device [file]
+ *
+ * Reads a continuous sequence of frames from file (a FIFO, say) or
+ * stdin: PBM/PGM pictures, raw WxH gray with -r, or packed planes of
+ * 2560 bytes (evpack output) with -P; pictures are dithered as by evpack
+ * (image.h). Each frame is compared with the one on the display and
+ * only runs of changed lines go out, ^C to the line and one ^I (^K for
+ * more than 6 lines) for the run. Floyd-Steinberg spreads a local
+ * change over the rest of the picture, -d o or -d t diff much better.
+ *
+ * Frames are read and packed in a thread of their own; if the link is
+ * still busy with the last frame when the next two arrive, the older one
+ * is dropped, so the display shows the newest frame the link can carry.
+ * Over a serial port every frame ends with a ^B round trip, the kernel's
+ * buffer would hide the backlog otherwise; -b is as for evsend.
+ *
+ * Prints frames sent and dropped, frames/s, latency (frame read to frame
+ * out) and bytes per frame on stderr at the end, and once a second with
+ * -v.
+ */
+
+#include "everavr.h"
+#include "image.h"
+#include "../protocol.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+
+#define GRAPHIC_BASE 0x0140 /* lcd_hardware.h */
+
+typedef std::chrono::steady_clock clk;
+
+static const unsigned LINE = everavr::packer::line;
+static const unsigned LINES = everavr::packer::height;
+
+/* the newest frame that isn't out yet, from reader to sender */
+static struct {
+	std::mutex mtx;
+	std::condition_variable ready;
+	uint8_t plane[everavr::packer::size];
+	clk::time_point t;  /* when it was read */
+	bool full, eof;
+	unsigned long read, dropped;
+} slot;
+
+static void
+reader(FILE *in,everavr::packer *p,unsigned rw,unsigned rh,bool packed){
+	static uint8_t plane[everavr::packer::size];
+	everavr::image img;
+
+	try {
+		for(;;){
+			if(packed){
+				size_t n = fread(plane,1,sizeof(plane),in);
+				if(n == 0 && feof(in))
+					break;
+				if(n != sizeof(plane))
+					throw std::runtime_error("short plane");
+			} else {
+				if(!(rw ? everavr::read_raw(in,rw,rh,img) :
+				     everavr::read_pnm(in,img)))
+					break;
+				p->pack(img,plane);
+			}
+			std::lock_guard<std::mutex> l(slot.mtx);
+			if(slot.full)
+				slot.dropped++;
+			std::copy(plane,plane+sizeof(plane),slot.plane);
+			slot.t = clk::now();
+			slot.full = true;
+			slot.read++;
+			slot.ready.notify_one();
+		}
+	} catch(std::exception &e){
+		fprintf(stderr,"evstream: frame %lu: %s\n",slot.read,e.what());
+	}
+	std::lock_guard<std::mutex> l(slot.mtx);
+	slot.eof = true;
+	slot.ready.notify_one();
+}
+
+/* queue the lines of cur that differ from shown; returns bytes queued */
+static size_t
+send_diff(everavr::client &c,const uint8_t *cur,uint8_t *shown){
+	size_t bytes = 0;
+	unsigned y = 0, y0;
+
+	while(y < LINES){
+		if(!std::equal(cur + y*LINE,cur + (y+1)*LINE,shown + y*LINE)){
+			for(y0=y++;y < LINES &&
+			    !std::equal(cur + y*LINE,cur + (y+1)*LINE,
+			    shown + y*LINE);y++)
+				;
+			c.addr(GRAPHIC_BASE + y0*LINE);
+			c.bulk(cur + y0*LINE,(y - y0)*LINE);
+			bytes += 3 + ((y - y0)*LINE <= 256 ? 2 : 3) +
+				(y - y0)*LINE;
+			std::copy(cur + y0*LINE,cur + y*LINE,shown + y0*LINE);
+		} else
+			y++;
+	}
+	return bytes;
+}
+
+/* a reader blocked in fread() can't be woken; when the sender gives up
+   on an exception it is left to exit() instead of std::terminate() */
+struct reader_thread {
+	std::thread t;
+	~reader_thread(){
+		if(t.joinable())
+			t.detach();
+	}
+};
+
+struct tally {
+	unsigned long frames, bytes;
+	double lat_sum, lat_max;
+};
+
+static void
+report(const char *what,const tally &t,double secs,unsigned long dropped){
+	fprintf(stderr,"%s%lu frames, %lu dropped, %.1f frames/s, latency "
+		"%.1f ms avg %.1f ms max, %.0f bytes/frame\n",what,t.frames,
+		dropped,secs > 0 ? t.frames / secs : 0.0,
+		t.frames ? t.lat_sum / t.frames * 1e3 : 0.0,t.lat_max * 1e3,
+		t.frames ? (double)t.bytes / t.frames : 0.0);
+}
+
+int
+main(int argc,char **argv){
+	everavr::dither_method method = everavr::dither_floyd;
+	unsigned baud = 0, level = 128, rw = 0, rh = 0;
+	bool invert = false, packed = false, verbose = false;
+	FILE *in = stdin;
+	int opt;
+
+	while((opt = getopt(argc,argv,"b:d:l:ir:Pv")) != -1){
+		switch(opt){
+		case 'b':
+			baud = strtoul(optarg,NULL,0);
+			break;
+		case 'd':
+			if(optarg[0] == 't')
+				method = everavr::dither_threshold;
+			else if(optarg[0] == 'o')
+				method = everavr::dither_ordered;
+			else if(optarg[0] == 'f')
+				method = everavr::dither_floyd;
+			else
+				optind = argc;
+			break;
+		case 'l':
+			level = strtoul(optarg,NULL,0);
+			break;
+		case 'i':
+			invert = true;
+			break;
+		case 'r':
+			if(sscanf(optarg,"%ux%u",&rw,&rh) != 2 || !rw || !rh)
+				optind = argc;
+			break;
+		case 'P':
+			packed = true;
+			break;
+		case 'v':
+			verbose = true;
+			break;
+		default:
+			optind = argc;
+		}
+	}
+	if(optind >= argc || optind+2 < argc || level > 255 ||
+	   (packed && rw)){
+		fprintf(stderr,"usage: %s [-b baud] [-d t|o|f] [-l level] [-i] "
+			"[-r WxH | -P] [-v] device [file]\n",argv[0]);
+		return 1;
+	}
+	if(optind+1 < argc && !(in = fopen(argv[optind+1],"rb"))){
+		perror(argv[optind+1]);
+		return 1;
+	}
+
+	try {
+		std::unique_ptr<everavr::transport> t =
+			everavr::open_transport(argv[optind]);
+		everavr::tty_transport *tty =
+			dynamic_cast<everavr::tty_transport *>(t.get());
+		everavr::client c(std::move(t));
+		unsigned got = c.baud(baud);
+		if(got && baud && got != baud)
+			fprintf(stderr,"%s: no %u bps, staying at %u\n",argv[0],
+				baud,got);
+		everavr::packer p(method,level,invert);
+		static uint8_t cur[everavr::packer::size];
+		static uint8_t shown[everavr::packer::size];
+		uint8_t seq = 0;
+		bool first = true;
+		tally all = tally(), sec = tally();
+		unsigned long dropped = 0, dropped_ts = 0;
+		clk::time_point t0 = clk::now(), ts = t0, tf;
+
+		reader_thread rd;
+		rd.t = std::thread(reader,in,&p,rw,rh,packed);
+		for(;;){
+			{
+				std::unique_lock<std::mutex> l(slot.mtx);
+				slot.ready.wait(l,[]{ return slot.full || slot.eof; });
+				if(!slot.full)
+					break;
+				std::copy(slot.plane,slot.plane+sizeof(slot.plane),cur);
+				tf = slot.t;
+				slot.full = false;
+				dropped = slot.dropped;
+			}
+			if(first){ /* nothing is known about the display */
+				for(size_t i=0;i<sizeof(shown);i++)
+					shown[i] = ~cur[i];
+				first = false;
+			}
+			size_t n = send_diff(c,cur,shown);
+			if(tty){ /* until the firmware has eaten it */
+				uint8_t ping[2] = { CHAR_ECHO, ++seq }, b = ~seq;
+				c.submit(ping,2);
+				c.flush();
+				while(read(tty->fileno(),&b,1) == 1 && b != seq)
+					;
+			} else
+				c.flush();
+
+			double lat = std::chrono::duration<double>(clk::now() -
+				tf).count();
+			for(tally *k : { &all, &sec }){
+				k->frames++;
+				k->bytes += n;
+				k->lat_sum += lat;
+				if(lat > k->lat_max)
+					k->lat_max = lat;
+			}
+			if(verbose && clk::now() - ts >= std::chrono::seconds(1)){
+				report("",sec,std::chrono::duration<double>(
+					clk::now() - ts).count(),dropped - dropped_ts);
+				dropped_ts = dropped;
+				sec = tally();
+				ts = clk::now();
+			}
+		}
+		rd.t.join();
+
+		report("total: ",all,std::chrono::duration<double>(clk::now() -
+			t0).count(),slot.dropped);
+		everavr::stats st = c.get_stats();
+		return st.errors ? 1 : 0;
+	} catch(std::exception &e){
+		fprintf(stderr,"%s: %s\n",argv[0],e.what());
+		return 1;
+	}
+}
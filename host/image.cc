@@ -0,0 +1,221 @@
+#include "image.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace everavr {
+
+/* ---------- reading ---------- */
+
+/* header field of a PNM: skips whitespace and comments */
+static unsigned
+pnm_int(FILE *f){
+	int c;
+	unsigned v = 0, digits = 0;
+
+	while((c = getc(f)) != EOF){
+		if(c == '#'){
+			while((c = getc(f)) != EOF && c != '\n')
+				;
+			continue;
+		}
+		if(c == ' ' || c == '\t' || c == '\r' || c == '\n')
+			continue;
+		break;
+	}
+	while(c >= '0' && c <= '9'){
+		v = v * 10 + (c - '0');
+		digits++;
+		c = getc(f);
+	}
+	if(!digits)
+		throw std::runtime_error("bad PNM header or data");
+	return v; /* c, a single whitespace, is consumed */
+}
+
+bool
+read_pnm(FILE *f,image &img){
+	int c, type;
+	unsigned maxval = 1;
+	size_t n;
+
+	do
+		c = getc(f);
+	while(c == ' ' || c == '\t' || c == '\r' || c == '\n');
+	if(c == EOF)
+		return false;
+	type = getc(f);
+	if(c != 'P' || type < '1' || type == '3' || type > '5')
+		throw std::runtime_error("not a PBM (P1, P4) or PGM (P2, P5)");
+
+	img.width = pnm_int(f);
+	img.height = pnm_int(f);
+	if(type == '2' || type == '5')
+		maxval = pnm_int(f);
+	if(!img.width || !img.height || !maxval || maxval > 65535)
+		throw std::runtime_error("bad PNM size or maxval");
+	n = (size_t)img.width * img.height;
+	img.pix.resize(n);
+
+	switch(type){
+	case '1': /* 1 = black, whitespace optional */
+		for(size_t i=0;i<n;i++){
+			do
+				c = getc(f);
+			while(c == ' ' || c == '\t' || c == '\r' || c == '\n');
+			if(c != '0' && c != '1')
+				throw std::runtime_error("bad P1 data");
+			img.pix[i] = c == '1' ? 0 : 255;
+		}
+		break;
+	case '4': { /* rows padded to bytes, MSB first */
+		std::vector<uint8_t> row((img.width + 7) / 8);
+		for(unsigned y=0;y<img.height;y++){
+			if(fread(row.data(),1,row.size(),f) != row.size())
+				throw std::runtime_error("short P4 data");
+			for(unsigned x=0;x<img.width;x++)
+				img.pix[y * img.width + x] =
+					(row[x >> 3] << (x & 7)) & 0x80 ? 0 : 255;
+		}
+		break;
+	}
+	case '2':
+		for(size_t i=0;i<n;i++)
+			img.pix[i] = pnm_int(f) * 255 / maxval;
+		break;
+	case '5':
+		if(maxval < 256){
+			if(fread(img.pix.data(),1,n,f) != n)
+				throw std::runtime_error("short P5 data");
+			if(maxval != 255)
+				for(size_t i=0;i<n;i++)
+					img.pix[i] = img.pix[i] * 255 / maxval;
+			break;
+		}
+		for(size_t i=0;i<n;i++){ /* 16 bit, big endian */
+			int hi = getc(f), lo = getc(f);
+			if(lo == EOF)
+				throw std::runtime_error("short P5 data");
+			img.pix[i] = ((hi << 8) | lo) * 255 / maxval;
+		}
+		break;
+	}
+	return true;
+}
+
+bool
+read_raw(FILE *f,unsigned width,unsigned height,image &img){
+	size_t n = (size_t)width * height, got;
+
+	img.width = width;
+	img.height = height;
+	img.pix.resize(n);
+	got = fread(img.pix.data(),1,n,f);
+	if(got == 0 && feof(f))
+		return false;
+	if(got != n)
+		throw std::runtime_error("short raw frame");
+	return true;
+}
+
+/* ---------- packing ---------- */
+
+/* SWAR: six 0/1 bytes in a word; the multiply moves byte i to bit
+   63-i without any two partial products meeting, so no carries */
+static inline uint8_t
+pack6(const uint8_t *p){
+	uint64_t v = (uint64_t)p[0] | (uint64_t)p[1] << 8 |
+		(uint64_t)p[2] << 16 | (uint64_t)p[3] << 24 |
+		(uint64_t)p[4] << 32 | (uint64_t)p[5] << 40;
+	return (v * 0x8040201008040201ull) >> 58;
+}
+
+#ifdef __SSE2__
+/* movemask yields the leftmost pixel in bit 0, the plane wants bit 5 */
+struct rev6_table {
+	uint8_t t[64];
+	rev6_table(){
+		for(unsigned i=0;i<64;i++){
+			t[i] = 0;
+			for(unsigned b=0;b<6;b++)
+				if(i & (1 << b))
+					t[i] |= 0x20 >> b;
+		}
+	}
+};
+static const rev6_table rev6;
+#endif
+
+void
+pack_bits(const uint8_t *bits,uint8_t *out,size_t n){
+#ifdef __SSE2__
+	for(;n >= 48;n -= 48,bits += 48,out += 8){
+		uint64_t m = 0;
+		for(unsigned k=0;k<3;k++){
+			__m128i v = _mm_loadu_si128((const __m128i *)(bits + 16*k));
+			m |= (uint64_t)(uint16_t)_mm_movemask_epi8(
+				_mm_slli_epi16(v,7)) << (16*k);
+		}
+		for(unsigned k=0;k<8;k++)
+			out[k] = rev6.t[(m >> (6*k)) & 0x3f];
+	}
+#endif
+	for(;n >= 6;n -= 6,bits += 6)
+		*out++ = pack6(bits);
+}
+
+packer::packer(dither_method m,uint8_t l,bool inv)
+	: method(m), level(l), invert(inv), err(width+2), next(width+2) {}
+
+void
+packer::pack(const image &img,uint8_t *out){
+	static const uint8_t bayer[4][4] = {
+		{  0,  8,  2, 10 },
+		{ 12,  4, 14,  6 },
+		{  3, 11,  1,  9 },
+		{ 15,  7, 13,  5 },
+	};
+
+	if(method == dither_floyd)
+		std::fill(err.begin(),err.end(),0);
+
+	for(unsigned y=0;y<height;y++,out += line){
+		const uint8_t *src = y < img.height ?
+			&img.pix[(size_t)y * img.width] : 0;
+		if(method == dither_floyd)
+			std::fill(next.begin(),next.end(),0);
+
+		for(unsigned x=0;x<width;x++){
+			int g = src && x < img.width ? src[x] : 255;
+			if(invert)
+				g = 255 - g;
+			switch(method){
+			case dither_threshold:
+				bits[x] = g < level;
+				break;
+			case dither_ordered:
+				bits[x] = g < bayer[y & 3][x & 3] * 16 + 8;
+				break;
+			case dither_floyd: { /* err[x+1] is pixel x */
+				int v = g + err[x+1], e;
+				bits[x] = v < level;
+				e = bits[x] ? v : v - 255;
+				err[x+2]  += e * 7 / 16;
+				next[x]   += e * 3 / 16;
+				next[x+1] += e * 5 / 16;
+				next[x+2] += e / 16;
+				break;
+			}
+			}
+		}
+		if(method == dither_floyd)
+			err.swap(next);
+		pack_bits(bits,out,width);
+	}
+}
+
+} // namespace everavr
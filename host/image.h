@@ -0,0 +1,69 @@
+#ifndef EVERAVR_IMAGE_H
+#define EVERAVR_IMAGE_H
+
+/* images to graphics plane contents, for libeveravr
+ *
+ * Pictures are read as 8 bit grayscale (PBM, PGM or raw), dithered to
+ * one bit per pixel and packed the way CMD_GRAPHIC_AREA 0x28 lays out
+ * the plane: 40 bytes per line, 6 pixels per byte, leftmost pixel in
+ * bit 5 (../lcd_hardware.h). Dark pixels are on.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include <vector>
+
+namespace everavr {
+
+/* 0 = black .. 255 = white, row by row */
+struct image {
+	unsigned width, height;
+	std::vector<uint8_t> pix;
+	image() : width(0), height(0) {}
+};
+
+/* next picture of a stream of PNM files: PBM (P1, P4) or PGM (P2, P5,
+   maxval up to 65535). false at the end of f, throws std::runtime_error
+   on anything else */
+bool read_pnm(FILE *f,image &img);
+
+/* next width x height bytes of raw gray, false at the end of f; a
+   short frame throws std::runtime_error */
+bool read_raw(FILE *f,unsigned width,unsigned height,image &img);
+
+enum dither_method {
+	dither_threshold,   /* darker than the level: on */
+	dither_ordered,     /* 4x4 Bayer matrix */
+	dither_floyd        /* Floyd-Steinberg error diffusion */
+};
+
+/* n pixels of 0/1 bytes (n a multiple of 6) to n/6 plane bytes;
+   SSE2 where the compiler has it, 48 pixels per round */
+void pack_bits(const uint8_t *bits,uint8_t *out,size_t n);
+
+class packer {
+public:
+	static const unsigned width = 240, height = 64;
+	static const unsigned line = 40;               /* bytes */
+	static const size_t size = line * height;      /* 2560 */
+
+	explicit packer(dither_method m=dither_floyd,uint8_t level=128,
+		bool invert=false);
+
+	/* the whole plane from img, which is cropped or padded with white
+	   at the right and bottom; out gets size bytes */
+	void pack(const image &img,uint8_t *out);
+
+private:
+	dither_method method;
+	uint8_t level;
+	bool invert;
+	uint8_t bits[width];
+	std::vector<int16_t> err, next; /* Floyd-Steinberg, width+2 each */
+};
+
+} // namespace everavr
+
+#endif
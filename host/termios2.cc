@@ -0,0 +1,23 @@
+/* serial port rates that aren't in <termios.h>, like the 750000 and
+   1125000 of ^U: BOTHER takes any rate the driver can do. The kernel's
+   struct termios2 doesn't go together with glibc's <termios.h>, so this
+   is a file of its own. Linux only, as is the rest of libeveravr. */
+
+#include <asm/termbits.h>
+#include <sys/ioctl.h>
+
+namespace everavr {
+
+bool
+tty_set_rate(int fd,unsigned baud){
+	struct termios2 tio;
+
+	if(ioctl(fd,TCGETS2,&tio) < 0)
+		return false;
+	tio.c_cflag &= ~(CBAUD | (CBAUD << IBSHIFT));
+	tio.c_cflag |= BOTHER | (BOTHER << IBSHIFT);
+	tio.c_ispeed = tio.c_ospeed = baud;
+	return ioctl(fd,TCSETS2,&tio) == 0;
+}
+
+} // namespace everavr
@@ -1,71 +1,43 @@
 #include "lcd_hardware.h"
+#include "protocol.h"
 #include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+
+uint8_t lcd_bus_out;
+
+uint8_t lcd_ready[LCD_NREADY];
+uint8_t lcd_stamp, lcd_wait;
 
-/* raw hardware access function, write data or command register
-   depending on iscmd=1 (command) or =0 (data) */
 void
-lcd_write(uint8_t data,uint8_t iscmd){
-	/* set output pins */
-	PORTC = data; /* upper two bits in portc don't care! */
-	if(data & _BV(7))
-		PORTD |= _BV(7);
-	if(data & _BV(6))
-		PORTD |= _BV(6);
-	if(iscmd)
-		PORTD |= PORTD_CD;
-
-	DDRC = 0x3f;    /* write out data on pins 0..5 */
-	DDRD |= _BV(7);
-	DDRD |= _BV(6); /* write out data on pins 6,7 */
-	
-	PORTB &= ~PORTB_WR; /* \WR pulse width min 80 ns! */
-	asm("nop;");
-	/* data setup up min 80ns before \WR back to 1 */
-	PORTB |=  PORTB_WR; /* strobe \WR */
-
-	PORTD &= ~_BV(7);
-	PORTD &= ~_BV(6);
-	PORTD &= ~PORTD_CD;
-
-	DDRC = 0; /* disable drivers on 0..5 */
-	DDRD &= ~_BV(7); /* disable drivers on D6, D7, C/\D */
-	DDRD &= ~_BV(6); 
-}
-
-/* raw hardware access function, read data or status register
-   (depending on isstat=1 (status) or =0 (data) */
-uint8_t
-lcd_read(uint8_t isstat){
-	unsigned char ret;
-	/* set output pins */
-	if(isstat)
-		PORTD |= PORTD_CD; /* C/D setup time is min. 100 ns! */
-	asm("nop;"); /* assuming 10 MHz .. 20 MHz */
-	
-	PORTB &= ~PORTB_RD; /* \WR to 0, min. 80ns! */
-	/* datasheet: max 150ns from \RD->0 to valid data (T_ACC) */
-	asm("nop;"); /* assuming 10 MHz .. 20 MHz */
-	ret = PIND & 0xc0; /* upper two bits */
-	ret |= PINC;       /* lower six bits */
-	PORTB |=  PORTB_RD; /* \WR back to 1 */
-	PORTD &= ~PORTD_CD;
-	return ret;
+lcd_poll_only(){
+	uint8_t k;
+	for(k=0;k<LCD_NREADY;k++)
+		lcd_ready[k] = 0;
+	lcd_wait = 0;
 }
 
 /* write command to controller, check if it's ok to do so in status
-   register first. Poll status register 256 times before giving up.
-   Return 0 on success, 1 if status register never went ok */
+   register first (unless lcd_settled()). Poll status register 256 times
+   before giving up. Return 0 on success, 1 if status register never
+   went ok */
 uint8_t
 lcd_command(uint8_t cmd){
 	register uint8_t i=0;
-	do {
-		i--;
-		if(lcd_read(1) & STATUS_CMD_OK)
-			break;
-	} while(i!=0);
-	if(i==0)
-		return 1; // error
+	if(!lcd_settled()){
+		do {
+			i--;
+			if(lcd_read(1) & STATUS_CMD_OK)
+				break;
+		} while(i!=0);
+		tm_poll(TM_POLL_CMD,(uint8_t)-i);
+		if(i==0){
+			lcd_poll_only();
+			return 1; // error
+		}
+	}
 	lcd_write(cmd,1); /* write command */
+	lcd_written(LCD_READY_CMD);
 	return 0;
 }
 
@@ -73,18 +45,24 @@ lcd_command(uint8_t cmd){
 uint8_t
 lcd_data(uint8_t data){
 	register uint8_t i=0;
-	do {
-		i--;
-		if(lcd_read(1) & STATUS_DATA_OK)
-			break;
-	} while(i!=0);
-	if(i==0)
-		return 1; // error
+	if(!lcd_settled()){
+		do {
+			i--;
+			if(lcd_read(1) & STATUS_DATA_OK)
+				break;
+		} while(i!=0);
+		tm_poll(TM_POLL_CMD,(uint8_t)-i);
+		if(i==0){
+			lcd_poll_only();
+			return 1; // error
+		}
+	}
 	lcd_write(data,0); /* write command */
+	lcd_written(LCD_READY_DATA);
 	return 0;
 }
 
-/* read data from controller, remarks for lcd_command above apply, too */
+/* read data from controller, always polls */
 uint8_t
 lcd_get_data(uint8_t *data){
 	register uint8_t i=0;
@@ -93,10 +71,13 @@ lcd_get_data(uint8_t *data){
 		if(lcd_read(1) & STATUS_DATA_OK)
 			break;
 	} while(i!=0);
-	if(i==0)
+	tm_poll(TM_POLL_CMD,(uint8_t)-i);
+	if(i==0){
+		lcd_poll_only();
 		return 1; // error
-
+	}
 	*data = lcd_read(0); /* write command */
+	lcd_unsettled();
 	return 0;	
 }
 
@@ -136,41 +117,226 @@ lcd_command_read(uint8_t cmd,uint8_t *data){
 	return lcd_get_data(data);
 }
 
-/* write in auto-mode, check status byte first */
-static unsigned int
-lcd_auto_write(unsigned char data){
-	register unsigned int i=0;
-	do {
-		i--;
-		if(lcd_read(1) & STATUS_AUTO_WRITE_OK)
-			break;
-	} while(i!=0);
-	if(i==0)
-		return 1; // error
-
-	lcd_write(data,0); /* write command */
+/* leave auto mode: STA0/STA1 are not valid while in auto mode, so wait
+   for STA2/STA3 before posting CMD_AUTO_RESET */
+uint8_t
+lcd_auto_reset(){
+	register uint16_t i=0;
+	if(!lcd_settled()){
+		do {
+			i--;
+			if(lcd_read(1) &
+			   (STATUS_AUTO_WRITE_OK|STATUS_AUTO_READ_OK))
+				break;
+		} while(i!=0);
+		tm_poll(TM_POLL_AUTO_RD,-i);
+		if(i==0){
+			lcd_poll_only();
+			return 1; // error
+		}
+	}
+	lcd_write(CMD_AUTO_RESET,1);
+	lcd_written(LCD_READY_CMD);
 	return 0;
 }
 
-/* read in auto-mode, check status byte first. */
-static unsigned int
-lcd_auto_read(unsigned char *data){
-	register unsigned int i=0;
-	do {
-		i--;
-		if(lcd_read(1) & STATUS_AUTO_READ_OK)
-			break;
-	} while(i!=0);
-	if(i==0)
-		return 1; // error
+/* set when CG RAM contents are undefined (after init) */
+static uint8_t lcd_cgram_dirty;
 
-	*data=lcd_read(0); /* write command */
+void
+lcd_fill(uint16_t addr,uint16_t len,uint8_t val){
+	lcd_command_long(CMD_ADDRESS_POINTER,addr);
+	lcd_command(CMD_AUTO_WRITE);
+	while(len--)
+		lcd_auto_write(val);
+	lcd_auto_reset();
+}
+
+/* through a buffer on the stack, one auto read and one auto write
+   session per chunk; forward, so dst < src may overlap */
+void
+lcd_copy(uint16_t dst,uint16_t src,uint16_t len){
+	uint8_t buf[LCD_COPY_CHUNK], n, i;
+
+	while(len){
+		n = len > sizeof(buf) ? sizeof(buf) : len;
+		lcd_command_long(CMD_ADDRESS_POINTER,src);
+		lcd_command(CMD_AUTO_READ);
+		for(i=0;i<n;i++)
+			lcd_auto_read(&buf[i]);
+		lcd_auto_reset();
+		lcd_command_long(CMD_ADDRESS_POINTER,dst);
+		lcd_command(CMD_AUTO_WRITE);
+		for(i=0;i<n;i++)
+			lcd_auto_write(buf[i]);
+		lcd_auto_reset();
+		src += n;
+		dst += n;
+		len -= n;
+	}
+}
+
+void
+lcd_unpack_P(uint16_t addr,const uint8_t *src){
+	register uint16_t n;
+	uint8_t c,v;
+
+	lcd_command_long(CMD_ADDRESS_POINTER,addr);
+	lcd_command(CMD_AUTO_WRITE);
+	while((c = pgm_read_byte(src++)) != PACK_END){
+		if(c < PACK_REPEAT){          /* c literal bytes follow */
+			while(c--)
+				lcd_auto_write(pgm_read_byte(src++));
+			continue;
+		}
+		if(c < PACK_ZERO){            /* next byte (c & 0x3f)+2 times */
+			n = (c & 0x3f) + 2;
+			v = pgm_read_byte(src++);
+		} else {                      /* 14 bit count-1 of zeroes */
+			n = (((c & 0x3f) << 8) | pgm_read_byte(src++)) + 1;
+			v = 0;
+		}
+		while(n--)
+			lcd_auto_write(v);
+	}
+	lcd_auto_reset();
+}
+
+void
+lcd_cgram_prepare(){
+	if(!lcd_cgram_dirty)
+		return;
+	lcd_fill(LCD_CGRAM_BASE,LCD_CGRAM_HIGH-LCD_CGRAM_BASE,0);
+	lcd_cgram_dirty = 0;
+}
+
+#if LCD_READY == 1
+#define LCD_SETTLE_MAX	192	/* cycles */
+#define LCD_SETTLE_ROUNDS 2
+
+/* the writes the firmware does, one at a time, in the CG RAM (undefined
+   after setup anyway); everything before the measured write polls */
+enum lcd_probe {
+	lcd_probe_data,
+	lcd_probe_addr,
+	lcd_probe_bit,
+	lcd_probe_write_inc,
+	lcd_probe_home,
+	lcd_probe_auto_write,
+	lcd_probe_auto,
+	lcd_probe_auto_reset,
+	lcd_nprobes
+};
+
+static void
+lcd_probe(uint8_t p,uint8_t *in_auto){
+	if(*in_auto)
+		lcd_auto_reset();
+	*in_auto = p >= lcd_probe_auto_write && p != lcd_probe_auto_reset;
+	lcd_data(LCD_CGRAM_BASE & 0xff);
+	if(p == lcd_probe_data)
+		return;
+	lcd_data(LCD_CGRAM_BASE >> 8);
+	lcd_command(CMD_ADDRESS_POINTER);
+	switch(p){
+	case lcd_probe_bit:
+		lcd_command(CMD_BIT_SET);
+		break;
+	case lcd_probe_write_inc:
+		lcd_data(0);
+		lcd_command(CMD_DATA_WRITE_INC);
+		break;
+	case lcd_probe_home: /* as it was, for scroll.c */
+		lcd_command_long(CMD_GRAPHIC_HOME_ADDR,LCD_GRAPHIC_BASE);
+		break;
+	case lcd_probe_auto_write:
+		lcd_command(CMD_AUTO_WRITE);
+		break;
+	case lcd_probe_auto:
+		lcd_command(CMD_AUTO_WRITE);
+		lcd_auto_write(0);
+		break;
+	case lcd_probe_auto_reset:
+		lcd_command(CMD_AUTO_WRITE);
+		lcd_auto_write(0);
+		lcd_auto_reset();
+		break;
+	}
+}
+
+/* the shortest wait (cycles) after probe p until the status shows all
+   of the bits the next write looks at; the probe is done again for
+   every wait. 0 if it's more than LCD_SETTLE_MAX */
+static uint8_t
+lcd_settle(uint8_t p,uint8_t *in_auto){
+	uint8_t d, mask = p == lcd_probe_auto_write || p == lcd_probe_auto ?
+		STATUS_AUTO_WRITE_OK : STATUS_CMD_OK | STATUS_DATA_OK;
+	for(d=1;d<=LCD_SETTLE_MAX;d++){
+		lcd_probe(p,in_auto);
+		while((uint8_t)(TCNT0 - lcd_stamp) < d)
+			;
+		if((lcd_read(1) & mask) == mask)
+			return d;
+	}
 	return 0;
 }
 
+static void
+lcd_measure(){
+	uint8_t r[LCD_NREADY] = { 0 }, in_auto = 0, i, p, k, d;
+
+	for(i=0;i<LCD_SETTLE_ROUNDS;i++)
+		for(p=0;p<lcd_nprobes;p++){
+			if(!(d = lcd_settle(p,&in_auto)))
+				goto done; /* no elision then */
+			k = p == lcd_probe_data ? LCD_READY_DATA :
+				p == lcd_probe_auto ? LCD_READY_AUTO :
+				LCD_READY_CMD;
+			if(d > r[k])
+				r[k] = d;
+		}
+	for(k=0;k<LCD_NREADY;k++) /* a quarter and four cycles to spare */
+		lcd_ready[k] = r[k] + r[k] / 4 + 4;
+done:
+	if(in_auto)
+		lcd_auto_reset();
+}
+#endif
+
+/* Timer0 is ours, at F_CPU */
+static void
+lcd_ready_setup(){
+	lcd_poll_only(); /* while measuring, too */
+	if(!LCD_READY)
+		return;
+	TCCR0A = 0;
+	TCCR0B = _BV(CS00);
+#if LCD_READY == 1
+	/* once: a later setup (reset) runs with USB up, which can't wait
+	   with interrupts off that long */
+	static uint8_t measured[LCD_NREADY], done;
+	uint8_t k;
+	if(!done){
+		uint8_t sreg = SREG;
+		cli();
+		lcd_measure();
+		SREG = sreg;
+		for(k=0;k<LCD_NREADY;k++)
+			measured[k] = lcd_ready[k];
+		done = 1;
+	}
+	for(k=0;k<LCD_NREADY;k++)
+		lcd_ready[k] = measured[k];
+#else
+	uint8_t k;
+	for(k=0;k<LCD_NREADY;k++)
+		lcd_ready[k] = ((uint32_t)LCD_READY * (F_CPU / 1000000) + 999) /
+			1000;
+#endif
+}
+
 void
-lcd_hardware_init(){
-	register uint16_t w;
+lcd_hardware_setup(){
 	PORTD |= PORTD_RES; /* \RES -> 1, lcd should start running */
 
 	/* initialize */
@@ -202,15 +368,27 @@ lcd_hardware_init(){
 		 1 0x0168 ..0x018f line 2
 		 2 0x0190 ..0x01b7 line 3
 		63 0x0b18 ..0x0b3f line 64
-	   *GFX gen area*
-		starts at 0x0b40 .. ends at 0x1fff
+		   in terminal mode (term.c): text attributes, a ring of
+		   16 lines 0x0140 .. 0x03bf
+	   *unused*, except for scrolling or double buffering (scroll.c,
+	   page.c), a plane does one or the other
+		0x0b40 .. 0x153f 2nd half of the graphics ring / graphics page 1
+		0x1540 .. 0x17bf text ring, 16 lines / text page 1 (..0x167f)
+		0x17c0 .. 0x17ff
+	   *CG RAM*
+		0x1800 .. 0x1bff codes 0x00..0x7f, ext. CG only, cleared on
+		   demand: lcd_cgram_prepare(); lcd_measure() probes here
+		0x1c00 .. 0x1fff codes 0x80..0xff, with the internal CG too
 	*/
+	lcd_cgram_dirty = 1;
+	lcd_ready_setup();
+	lcd_fill(LCD_CGRAM_HIGH,LCD_RAM_SIZE-LCD_CGRAM_HIGH,0);
+}
 
-	/* clear whole memory with zeroes */
-	lcd_command_long(CMD_ADDRESS_POINTER,0x0000);
-	lcd_command(CMD_AUTO_WRITE);
-	for(w=0;w<LCD_RAM_SIZE;w++)
-		lcd_auto_write(0);
-	lcd_command(CMD_AUTO_RESET); /* should overflow */
+void
+lcd_hardware_init(){
+	lcd_hardware_setup();
+	/* text and graphics area are adjacent, clear both in one go */
+	lcd_fill(LCD_TEXT_BASE,LCD_TEXT_SIZE+LCD_GRAPHIC_SIZE,0);
 }
 
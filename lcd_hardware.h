@@ -2,6 +2,7 @@
 #define LCD_HARDWARE_H
 
 #include <avr/io.h>
+#include "telemetry.h"
 
 #define PORTD_CD  _BV(5)
 #define PORTD_RES _BV(4)
@@ -9,6 +10,34 @@
 #define PORTB_WR  _BV(1)
 #define PORTB_CS  _BV(0)
 
+/* The 8 bit data bus is split over two ports (see everavr.c): for each
+   half, the data bits in _MASK appear on the port shifted left by _LSH
+   or right by _RSH. _OWNED means nothing else lives on that port, so it
+   may be written as a whole. Everything below is resolved at compile
+   time, i.e. D0..D5 -> PC0..PC5 is a plain "out PORTC". */
+#define LCD_DLO_PORT	PORTC
+#define LCD_DLO_DDR	DDRC
+#define LCD_DLO_PIN	PINC
+#define LCD_DLO_MASK	0x3f	/* D0..D5 */
+#define LCD_DLO_LSH	0
+#define LCD_DLO_RSH	0
+#define LCD_DLO_OWNED	1	/* C6 is \Reset, C7 doesn't exist */
+
+#define LCD_DHI_PORT	PORTD
+#define LCD_DHI_DDR	DDRD
+#define LCD_DHI_PIN	PIND
+#define LCD_DHI_MASK	0xc0	/* D6, D7 */
+#define LCD_DHI_LSH	0
+#define LCD_DHI_RSH	0
+#define LCD_DHI_OWNED	0	/* shared with USB, C/\D, \RES and UART */
+
+/* data bits -> port bits and back, for one half of the bus */
+#define LCD_TO_PORT(d,h)   ((((d) & LCD_##h##_MASK) << LCD_##h##_LSH) \
+				>> LCD_##h##_RSH)
+#define LCD_FROM_PORT(p,h) ((((p) << LCD_##h##_RSH) >> LCD_##h##_LSH) \
+				& LCD_##h##_MASK)
+#define LCD_PORT_MASK(h)   LCD_TO_PORT(0xff,h)
+
 #define STATUS_CMD_OK		0x01
 #define STATUS_DATA_OK		0x02
 #define STATUS_AUTO_READ_OK	0x04
@@ -30,10 +59,16 @@
 #define CMD_MODE_OR		0x00
 #define CMD_MODE_EXOR		0x01
 #define CMD_MODE_AND		0x03
-#define CMD_MODE_TEXT_ATTRIB	0x04
-#define CMD_MODE_MASK           0x07 /* all sensible bits */
+#define CMD_MODE_TEXT_ATTRIB	0x04 /* graphics area holds text attributes */
 #define CMD_MODE_INT_CG		0x00
-#define CMD_MODE_EXT_CG		0x80
+#define CMD_MODE_EXT_CG		0x08
+#define CMD_MODE_MASK           0x0f /* all sensible bits */
+
+/* attribute bytes in CMD_MODE_TEXT_ATTRIB, one per text char */
+#define ATTRIB_NORMAL		0x00
+#define ATTRIB_REVERSE		0x05
+#define ATTRIB_INHIBIT		0x03
+#define ATTRIB_BLINK		0x08
 
 #define CMD_MODE_DISPLAY	0x90
 #define CMD_DISP_OFF		0x00
@@ -60,22 +95,167 @@
 #define CMD_SCREEN_PEEK		0xe0
 #define CMD_SCREEN_COPY		0xe8
 
+#define CMD_BIT_RESET		0xf0 /* | bit 0..7, byte at address pointer */
+#define CMD_BIT_SET		0xf8
+
 #define LCD_TEXT_BASE		0x0000  /* 0x0000 -> 0x013f */
+#define LCD_TEXT_SIZE		0x0140  /* 40 columns x 8 lines */
+#define LCD_TEXT_COLS		40
+#define LCD_TEXT_LINES		8
 #define LCD_GRAPHIC_BASE	0x0140  /* 0x0140 -> 0x0b3f */
+#define LCD_GRAPHIC_SIZE	0x0a00  /* 40 bytes x 64 lines */
+#define LCD_GRAPHIC_COLS	40      /* bytes per line */
+#define LCD_PIXELS_PER_BYTE	6       /* FS=1: bits 5..0, left to right */
+#define LCD_WIDTH		240
+#define LCD_HEIGHT		64
+	/* scrolling (scroll.c): each plane in a ring of twice its lines,
+	   the graphics ring starts with the normal graphics plane */
+#define LCD_GRAPHIC_RING	0x0140  /* 0x0140 -> 0x153f, 128 lines */
+#define LCD_TEXT_RING		0x1540  /* 0x1540 -> 0x17bf, 16 lines */
+#define LCD_ATTRIB_RING		0x0140  /* 0x0140 -> 0x03bf, text attributes,
+					   instead of the graphics plane */
+	/* double buffering (page.c): page 0 is the normal plane */
+#define LCD_GRAPHIC_PAGE1	0x0b40  /* 0x0b40 -> 0x153f */
+#define LCD_TEXT_PAGE1		0x1540  /* 0x1540 -> 0x167f */
 	/* Character Generator: a10..a3 -> character a2..a0 -> line */
 	/* so only a15..a11 can be choosen in ext. ram: mask 0xf800 */
 #define LCD_CGRAM_BASE		0x1800  /* 0x1800 -> 0x1fff */
+#define LCD_CGRAM_HIGH		0x1c00  /* codes 0x80.., in CG RAM with the
+					   internal CG, too */
 #define LCD_RAM_SIZE		0x2000
 
 
+/* 1 while the AVR drives the data bus. The bus is only turned around
+   when a read follows a write or vice versa, never after each access;
+   the controller drives it only while \RD is low, so that's safe. */
+extern uint8_t lcd_bus_out;
+
+static inline void
+lcd_bus_drive(){
+	if(LCD_DLO_OWNED)
+		LCD_DLO_DDR = LCD_PORT_MASK(DLO);
+	else
+		LCD_DLO_DDR |= LCD_PORT_MASK(DLO);
+	if(LCD_DHI_OWNED)
+		LCD_DHI_DDR = LCD_PORT_MASK(DHI);
+	else
+		LCD_DHI_DDR |= LCD_PORT_MASK(DHI);
+	lcd_bus_out = 1;
+}
+
+static inline void
+lcd_bus_release(){
+	if(LCD_DLO_OWNED)
+		LCD_DLO_DDR = 0;
+	else
+		LCD_DLO_DDR &= ~LCD_PORT_MASK(DLO);
+	if(LCD_DHI_OWNED)
+		LCD_DHI_DDR = 0;
+	else
+		LCD_DHI_DDR &= ~LCD_PORT_MASK(DHI);
+	lcd_bus_out = 0;
+}
+
 /* write data to data register (iscmd=0) or command register (iscmd=1) */
-extern void
-lcd_write(uint8_t data,uint8_t iscmd);
+static inline void
+lcd_write(uint8_t data,uint8_t iscmd){
+	if(iscmd)
+		PORTD |= PORTD_CD;
+	else
+		PORTD &= ~PORTD_CD;
+
+	if(LCD_DLO_OWNED)
+		LCD_DLO_PORT = LCD_TO_PORT(data,DLO);
+	else
+		LCD_DLO_PORT = (LCD_DLO_PORT & ~LCD_PORT_MASK(DLO))
+			| LCD_TO_PORT(data,DLO);
+	if(LCD_DHI_OWNED)
+		LCD_DHI_PORT = LCD_TO_PORT(data,DHI);
+	else
+		LCD_DHI_PORT = (LCD_DHI_PORT & ~LCD_PORT_MASK(DHI))
+			| LCD_TO_PORT(data,DHI);
+	if(!lcd_bus_out)
+		lcd_bus_drive();
+
+	PORTB &= ~PORTB_WR; /* \WR pulse width min 80 ns! */
+	asm("nop;");
+	/* data setup up min 80ns before \WR back to 1 */
+	PORTB |=  PORTB_WR; /* strobe \WR */
+}
 
 /* read data from data register (isstat=0) or status register (isstat=1) */
-extern uint8_t
-lcd_read(uint8_t isstat);
+static inline uint8_t
+lcd_read(uint8_t isstat){
+	uint8_t ret;
+
+	if(lcd_bus_out)
+		lcd_bus_release();
+	if(isstat)
+		PORTD |= PORTD_CD; /* C/D setup time is min. 100 ns! */
+	else
+		PORTD &= ~PORTD_CD;
+	asm("nop;"); /* assuming 10 MHz .. 20 MHz */
 
+	PORTB &= ~PORTB_RD; /* \RD to 0, min. 80ns! */
+	/* datasheet: max 150ns from \RD->0 to valid data (T_ACC) */
+	asm("nop;"); /* assuming 10 MHz .. 20 MHz */
+	ret  = LCD_FROM_PORT(LCD_DHI_PIN,DHI);
+	ret |= LCD_FROM_PORT(LCD_DLO_PIN,DLO);
+	PORTB |=  PORTB_RD; /* \RD back to 1 */
+	return ret;
+}
+
+
+/* Status poll elision: the controller is busy for a fixed time after
+   each write. Timer0 counts F_CPU cycles; every write notes when its
+   strobe was done and how long that kind of write keeps the controller
+   busy, counted from there (lcd_ready[]), and the next write skips the
+   status read if that much time has provably passed. (uint8_t)(TCNT0 -
+   lcd_stamp) is never more than the time since, so a wrapped counter
+   only costs a poll. LCD_READY: 0 always polls, 1 measures the times in
+   the first lcd_hardware_setup() with interrupts off (an interrupt
+   during a measured wait would understate it) and later setups reuse
+   them, anything else is a worst case in ns for all writes (the busy
+   time plus the write itself). A poll timeout goes back to polling
+   until the next setup, reads always poll. */
+#ifndef LCD_READY
+#define LCD_READY 1
+#endif
+
+#define LCD_READY_CMD	0	/* after lcd_command() */
+#define LCD_READY_DATA	1	/* lcd_data() */
+#define LCD_READY_AUTO	2	/* lcd_auto_write() */
+#define LCD_NREADY	3
+
+extern uint8_t lcd_ready[LCD_NREADY];	/* cycles, 0: poll */
+extern uint8_t lcd_stamp, lcd_wait;	/* the last write */
+
+/* 1 if the controller is provably done with the last write */
+static inline uint8_t
+lcd_settled(){
+	return LCD_READY && lcd_wait && (uint8_t)(TCNT0 - lcd_stamp) >= lcd_wait;
+}
+
+/* right after the \WR strobe of a write of the given kind: an interrupt
+   between the two only makes the stamp late, the next write then waits
+   longer than it has to, never shorter */
+static inline void
+lcd_written(uint8_t kind){
+	if(LCD_READY){
+		lcd_stamp = TCNT0;
+		lcd_wait = lcd_ready[kind];
+	}
+}
+
+/* after a read, and on errors: the next write polls again */
+static inline void
+lcd_unsettled(){
+	if(LCD_READY)
+		lcd_wait = 0;
+}
+
+/* a poll timed out: no more elision until lcd_hardware_setup() */
+extern void lcd_poll_only();
 
 /* poll status register for STATUS_CMD_OK, then write cmd to command reg.
    return 0 if ok, 1 if polling counter exceeds limit */
@@ -100,7 +280,77 @@ extern uint8_t lcd_command_2(uint8_t cmd,uint8_t data1,uint8_t data2);
 extern uint8_t lcd_command_long(uint8_t cmd,uint16_t data);
 extern uint8_t lcd_command_read(uint8_t cmd,uint8_t *data);
 
-/* do all kind of fancy stuff, clear RAM, enable graphics, set pointers */
+/* poll status register for STATUS_AUTO_WRITE_OK, then write data to data
+   reg. (only valid after CMD_AUTO_WRITE) return 0 if ok, 1 on timeout.
+   Inline, this is the inner loop of every bulk transfer. */
+static inline uint8_t
+lcd_auto_write(uint8_t data){
+	register uint16_t i=0;
+	if(!lcd_settled()){
+		do {
+			i--;
+			if(lcd_read(1) & STATUS_AUTO_WRITE_OK)
+				break;
+		} while(i!=0);
+		tm_poll(TM_POLL_AUTO_WR,-i);
+		if(i==0){
+			lcd_poll_only();
+			return 1; // error
+		}
+	}
+	lcd_write(data,0);
+	lcd_written(LCD_READY_AUTO);
+	return 0;
+}
+
+/* poll status register for STATUS_AUTO_READ_OK, then read data from data
+   reg. into *data (only valid after CMD_AUTO_READ) return 0 if ok, 1 on
+   timeout. Inline, inner loop of display RAM readback. */
+static inline uint8_t
+lcd_auto_read(uint8_t *data){
+	register uint16_t i=0;
+	do {
+		i--;
+		if(lcd_read(1) & STATUS_AUTO_READ_OK)
+			break;
+	} while(i!=0);
+	tm_poll(TM_POLL_AUTO_RD,-i);
+	if(i==0){
+		lcd_poll_only();
+		return 1; // error
+	}
+	*data = lcd_read(0);
+	lcd_unsettled();
+	return 0;
+}
+
+/* poll status register for STATUS_AUTO_WRITE_OK or STATUS_AUTO_READ_OK,
+   then post CMD_AUTO_RESET. return 0 if ok, 1 on timeout */
+extern uint8_t lcd_auto_reset();
+
+/* write len times val to display RAM from addr on, in auto mode */
+extern void lcd_fill(uint16_t addr,uint16_t len,uint8_t val);
+
+/* copy len bytes of display RAM from src to dst, LCD_COPY_CHUNK at a
+   time (stack) */
+#define LCD_COPY_CHUNK 40
+extern void lcd_copy(uint16_t dst,uint16_t src,uint16_t len);
+
+/* unpack data in PROGMEM (packed format, see protocol.h) to display RAM
+   starting at addr, in auto mode */
+extern void lcd_unpack_P(uint16_t addr,const uint8_t *src);
+
+/* the external CG's half of CG RAM (codes 0x00..0x7f) is not cleared by
+   lcd_hardware_setup(), call this before it's used, it clears
+   LCD_CGRAM_BASE..LCD_CGRAM_HIGH once after every setup */
+extern void lcd_cgram_prepare();
+
+/* enable graphics, set pointers and modes, set up poll elision (see
+   LCD_READY), clear CG RAM from LCD_CGRAM_HIGH on; leaves the rest of
+   display RAM alone */
+extern void lcd_hardware_setup();
+
+/* lcd_hardware_setup(), then clear the text and graphics area */
 extern void lcd_hardware_init();
 
 #endif
@@ -0,0 +1,160 @@
+#!/usr/bin/python
+# generate font8.h, the proportional 8 pixel fonts (regular and bold)
+# that gfx_text() draws into the graphics plane (^N, see protocol.h)
+#
+#   mkfont.py [-o font8.h]
+#
+# Glyphs are 8 rows, '/' separated, '#' is a set pixel; rows 0..6 hold
+# capitals and digits, row 7 descenders. Each glyph is stored as its
+# columns, bit 0 = top row, in font8_cols[]; font8_offs[c - first] is
+# where the columns of c start, the next entry where they end. The bold
+# variant (font8b_*) is each glyph OR'ed with itself shifted right by one.
+
+import sys
+import getopt
+
+GLYPHS = [
+	(' ', '../../../../../../../..'),
+	('!', '#/#/#/#/#/./#/.'),
+	('"', '#.#/#.#/.../.../.../.../.../...'),
+	('#', '.#.#./.#.#./#####/.#.#./#####/.#.#./.#.#./.....'),
+	('$', '..#../.####/#.#../.###./..#.#/####./..#../.....'),
+	('%', '##.../##..#/...#./..#../.#.../#..##/...##/.....'),
+	('&', '.##../#..#./#.#../.#.../#.#.#/#..#./.##.#/.....'),
+	("'", '#/#/./././././.'),
+	('(', '.#/#./#./#./#./#./.#/..'),
+	(')', '#./.#/.#/.#/.#/.#/#./..'),
+	('*', '...../..#../#.#.#/.###./#.#.#/..#../...../.....'),
+	('+', '...../..#../..#../#####/..#../..#../...../.....'),
+	(',', '../../../../../.#/.#/#.'),
+	('-', '..../..../..../####/..../..../..../....'),
+	('.', '././././././#/.'),
+	('/', '..../...#/...#/..#./.#../#.../#.../....'),
+	('0', '.##./#..#/#.##/##.#/#..#/#..#/.##./....'),
+	('1', '.#./##./.#./.#./.#./.#./###/...'),
+	('2', '.##./#..#/...#/..#./.#../#.../####/....'),
+	('3', '####/...#/..#./.##./...#/#..#/.##./....'),
+	('4', '..#./.##./#.#./#..#/####/...#/...#/....'),
+	('5', '####/#.../###./...#/...#/#..#/.##./....'),
+	('6', '.##./#.../#.../###./#..#/#..#/.##./....'),
+	('7', '####/...#/...#/..#./.#../.#../.#../....'),
+	('8', '.##./#..#/#..#/.##./#..#/#..#/.##./....'),
+	('9', '.##./#..#/#..#/.###/...#/...#/.##./....'),
+	(':', '././#/././#/./.'),
+	(';', '../../.#/../../.#/.#/#.'),
+	('<', '.../..#/.#./#../.#./..#/.../...'),
+	('=', '..../..../####/..../####/..../..../....'),
+	('>', '.../#../.#./..#/.#./#../.../...'),
+	('?', '.##./#..#/...#/..#./.#../..../.#../....'),
+	('@', '.###./#...#/#.###/#.#.#/#.###/#..../.###./.....'),
+	('A', '.##./#..#/#..#/####/#..#/#..#/#..#/....'),
+	('B', '###./#..#/#..#/###./#..#/#..#/###./....'),
+	('C', '.##./#..#/#.../#.../#.../#..#/.##./....'),
+	('D', '###./#..#/#..#/#..#/#..#/#..#/###./....'),
+	('E', '####/#.../#.../###./#.../#.../####/....'),
+	('F', '####/#.../#.../###./#.../#.../#.../....'),
+	('G', '.##./#..#/#.../#.##/#..#/#..#/.###/....'),
+	('H', '#..#/#..#/#..#/####/#..#/#..#/#..#/....'),
+	('I', '###/.#./.#./.#./.#./.#./###/...'),
+	('J', '...#/...#/...#/...#/...#/#..#/.##./....'),
+	('K', '#..#/#.#./##../#.../##../#.#./#..#/....'),
+	('L', '#.../#.../#.../#.../#.../#.../####/....'),
+	('M', '#...#/##.##/#.#.#/#.#.#/#...#/#...#/#...#/.....'),
+	('N', '#..#/##.#/##.#/#.##/#.##/#..#/#..#/....'),
+	('O', '.##./#..#/#..#/#..#/#..#/#..#/.##./....'),
+	('P', '###./#..#/#..#/###./#.../#.../#.../....'),
+	('Q', '.##./#..#/#..#/#..#/#..#/#.#./.#.#/....'),
+	('R', '###./#..#/#..#/###./#.#./#..#/#..#/....'),
+	('S', '.###/#.../#.../.##./...#/...#/###./....'),
+	('T', '#####/..#../..#../..#../..#../..#../..#../.....'),
+	('U', '#..#/#..#/#..#/#..#/#..#/#..#/.##./....'),
+	('V', '#...#/#...#/#...#/#...#/.#.#./.#.#./..#../.....'),
+	('W', '#...#/#...#/#...#/#.#.#/#.#.#/#.#.#/.#.#./.....'),
+	('X', '#...#/#...#/.#.#./..#../.#.#./#...#/#...#/.....'),
+	('Y', '#...#/#...#/.#.#./..#../..#../..#../..#../.....'),
+	('Z', '####/...#/..#./.#../#.../#.../####/....'),
+	('[', '##/#./#./#./#./#./##/..'),
+	('\\', '..../#.../#.../.#../..#./...#/...#/....'),
+	(']', '##/.#/.#/.#/.#/.#/##/..'),
+	('^', '.#./#.#/.../.../.../.../.../...'),
+	('_', '..../..../..../..../..../..../..../####'),
+	('`', '#./.#/../../../../../..'),
+	('a', '..../..../.##./...#/.###/#..#/.###/....'),
+	('b', '#.../#.../###./#..#/#..#/#..#/###./....'),
+	('c', '.../.../.##/#../#../#../.##/...'),
+	('d', '...#/...#/.###/#..#/#..#/#..#/.###/....'),
+	('e', '..../..../.##./#..#/####/#.../.###/....'),
+	('f', '.##/#../###/#../#../#../#../...'),
+	('g', '..../..../.###/#..#/#..#/.###/...#/.##.'),
+	('h', '#.../#.../###./#..#/#..#/#..#/#..#/....'),
+	('i', '#/./#/#/#/#/#/.'),
+	('j', '.#/../.#/.#/.#/.#/.#/#.'),
+	('k', '#.../#.../#..#/#.#./##../#.#./#..#/....'),
+	('l', '#./#./#./#./#./#./.#/..'),
+	('m', '...../...../##.#./#.#.#/#.#.#/#.#.#/#.#.#/.....'),
+	('n', '..../..../###./#..#/#..#/#..#/#..#/....'),
+	('o', '..../..../.##./#..#/#..#/#..#/.##./....'),
+	('p', '..../..../###./#..#/#..#/###./#.../#...'),
+	('q', '..../..../.###/#..#/#..#/.###/...#/...#'),
+	('r', '.../.../#.#/##./#../#../#../...'),
+	('s', '..../..../.###/#.../.##./...#/###./....'),
+	('t', '#../#../###/#../#../#../.##/...'),
+	('u', '..../..../#..#/#..#/#..#/#..#/.###/....'),
+	('v', '...../...../#...#/#...#/.#.#./.#.#./..#../.....'),
+	('w', '...../...../#...#/#...#/#.#.#/#.#.#/.#.#./.....'),
+	('x', '..../..../#..#/#..#/.##./#..#/#..#/....'),
+	('y', '..../..../#..#/#..#/#..#/.###/...#/.##.'),
+	('z', '..../..../####/..#./.#../#.../####/....'),
+	('{', '..#/.#./.#./#../.#./.#./..#/...'),
+	('|', '#/#/#/#/#/#/#/.'),
+	('}', '#../.#./.#./..#/.#./.#./#../...'),
+	('~', '..../..../.#.#/#.#./..../..../..../....'),
+]
+
+HEIGHT = 8
+SPACING = 1 # blank columns after each glyph
+
+opts,args = getopt.getopt(sys.argv[1:],'o:')
+opts = dict(opts)
+
+def columns(bold) :
+	cols = []
+	offs = []
+	for i,(c,art) in enumerate(GLYPHS) :
+		assert ord(c) == first + i, c
+		rows = art.split('/')
+		assert len(rows) == HEIGHT and len(set(map(len,rows))) == 1, c
+		g = [ sum(1 << y for y in range(HEIGHT) if rows[y][x] == '#')
+			for x in range(len(rows[0])) ]
+		if bold :
+			g = [ a | b for a,b in zip(g + [0], [0] + g) ]
+		offs.append(len(cols))
+		cols += g
+	offs.append(len(cols))
+	return offs,cols
+
+def emit(out,name,offs,cols) :
+	out.write('static PROGMEM const uint16_t %s_offs[%d] = {\n'%(name,len(offs)))
+	for i in range(0,len(offs),8) :
+		out.write('\t' + ' '.join('%3d,'%(o) for o in offs[i:i+8]) + '\n')
+	out.write('};\n\n')
+	out.write('static PROGMEM const uint8_t %s_cols[%d] = {\n'%(name,len(cols)))
+	for i in range(0,len(cols),12) :
+		out.write('\t' + ' '.join('0x%02x,'%(b) for b in cols[i:i+12]) + '\n')
+	out.write('};\n')
+
+first = ord(GLYPHS[0][0])
+regular = columns(False)
+bold = columns(True)
+
+out = open(opts.get('-o','font8.h'),'w')
+out.write('/* proportional %d pixel fonts, chars 0x%02x..0x%02x, %d+%d bytes of\n'
+	'   glyph columns, generated by mkfont.py */\n'%(
+	HEIGHT,first,first+len(GLYPHS)-1,len(regular[1]),len(bold[1])))
+out.write('#define FONT8_HEIGHT  %d\n'%(HEIGHT))
+out.write('#define FONT8_FIRST   0x%02x\n'%(first))
+out.write('#define FONT8_LAST    0x%02x\n'%(first+len(GLYPHS)-1))
+out.write('#define FONT8_SPACING %d\n\n'%(SPACING))
+emit(out,'font8',*regular)
+out.write('\n')
+emit(out,'font8b',*bold)
@@ -0,0 +1,34 @@
+#!/usr/bin/python
+# generate splash.h, the packed boot screen (text area followed by the
+# graphics plane) that main() unpacks into display RAM at power-up
+#
+#   mksplash.py [-p image.pbm] [-o splash.h] [text line]...
+
+import sys
+import getopt
+import everavr
+
+opts,args = getopt.getopt(sys.argv[1:],'p:o:')
+opts = dict(opts)
+
+text = bytearray(everavr.TEXT_COLS*everavr.TEXT_LINES)
+for y,line in enumerate(args[:everavr.TEXT_LINES]) :
+	line = everavr.text_bytes(line[:everavr.TEXT_COLS])
+	text[y*everavr.TEXT_COLS:y*everavr.TEXT_COLS+len(line)] = line
+
+if '-p' in opts :
+	gfx = everavr.pack_pixels(everavr.read_pbm(opts['-p']))
+else :
+	gfx = bytes(everavr.GRAPHIC_COLS*everavr.HEIGHT)
+
+raw = bytes(text) + gfx
+packed = everavr.pack(raw)
+assert everavr.unpack(packed) == raw
+
+out = open(opts.get('-o','splash.h'),'w')
+out.write('/* boot screen, %d bytes packed to %d, generated by\n   mksplash.py %s */\n'%(
+	len(raw),len(packed),' '.join(repr(a) if ' ' in a else a for a in sys.argv[1:])))
+out.write('PROGMEM const uint8_t splash[%d] = {\n'%(len(packed)))
+for i in range(0,len(packed),12) :
+	out.write('\t' + ' '.join('0x%02x,'%(b) for b in bytearray(packed[i:i+12])) + '\n')
+out.write('};\n')
@@ -0,0 +1,76 @@
+#include "page.h"
+#include "scroll.h"
+#include "lcd_hardware.h"
+#include "protocol.h"
+
+static const uint16_t page_bases[2][2] = {
+	{ LCD_TEXT_BASE, LCD_TEXT_PAGE1 },		/* SCROLL_TEXT */
+	{ LCD_GRAPHIC_BASE, LCD_GRAPHIC_PAGE1 },	/* SCROLL_GRAPHICS */
+};
+static const uint16_t page_size[2] = { LCD_TEXT_SIZE, LCD_GRAPHIC_SIZE };
+static const uint8_t page_cmd[2] = { CMD_TEXT_HOME_ADDR,
+	CMD_GRAPHIC_HOME_ADDR };
+
+static uint8_t page_front;  /* bit per plane: page 1 is on screen */
+static uint8_t page_back;   /* bit per plane: drawing goes off screen */
+static uint8_t page_clean;  /* bit per plane: page 1 is no leftover RAM */
+
+uint16_t
+page_base(uint8_t plane){
+	return page_bases[plane][((page_front ^ page_back) >> plane) & 1];
+}
+
+uint16_t
+page_addr(uint16_t addr){
+	uint8_t plane;
+	for(plane=0;plane<2;plane++)
+		if(addr >= page_bases[plane][0] &&
+		   addr < page_bases[plane][0] + page_size[plane])
+			return addr - page_bases[plane][0] + page_base(plane);
+	return addr;
+}
+
+void
+page(uint8_t op){
+	uint8_t planes = _BV(SCROLL_GRAPHICS), plane;
+
+	if(op & PAGE_TEXT)
+		planes |= _BV(SCROLL_TEXT);
+	for(plane=0;plane<2;plane++){
+		if(!(planes & _BV(plane)))
+			continue;
+		scroll(SCROLL_OFF | plane,0); /* page 1 is its ring */
+		if(!(page_clean & _BV(plane))){
+			lcd_fill(page_bases[plane][1],page_size[plane],0);
+			page_clean |= _BV(plane);
+		}
+		if(!(op & PAGE_FLIP))
+			continue;
+		page_front ^= _BV(plane);
+		lcd_command_long(page_cmd[plane],
+			page_bases[plane][(page_front >> plane) & 1]);
+		if(op & PAGE_COPY) /* new front to new back */
+			lcd_copy(page_bases[plane][(~page_front >> plane) & 1],
+				page_bases[plane][(page_front >> plane) & 1],
+				page_size[plane]);
+	}
+	page_back = op & PAGE_BACK ? planes : 0;
+}
+
+void
+page_end(uint8_t plane){
+	page_back &= ~_BV(plane);
+	page_clean &= ~_BV(plane); /* the ring goes there */
+	if(!(page_front & _BV(plane)))
+		return;
+	lcd_copy(page_bases[plane][0],page_bases[plane][1],page_size[plane]);
+	lcd_command_long(page_cmd[plane],page_bases[plane][0]);
+	page_front &= ~_BV(plane);
+}
+
+void
+page_reset(){
+	page_front = 0;
+	page_back = 0;
+	page_clean = 0;
+}
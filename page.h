@@ -0,0 +1,31 @@
+#ifndef PAGE_H
+#define PAGE_H
+
+#include <stdint.h>
+
+/* Double buffered text area and graphics plane (^X, protocol.h): page
+   0 is the normal plane, page 1 sits in the otherwise unused display RAM
+   (lcd_hardware.h). A flip only rewrites the home address. The first ^X
+   for a plane clears its page 1, whatever was there (a scroll ring, or
+   RAM never written since power up). Planes are SCROLL_TEXT /
+   SCROLL_GRAPHICS (scroll.h). */
+
+/* ^X op */
+extern void page(uint8_t op);
+
+/* where drawing into plane goes: the page on screen, or the other one
+   after PAGE_BACK */
+extern uint16_t page_base(uint8_t plane);
+
+/* addr as sent with ^C or ^R: inside page 0 of a plane that is drawn
+   into its back page, moved there */
+extern uint16_t page_addr(uint16_t addr);
+
+/* single buffer again, page 1 copied to page 0 if it's on screen;
+   before the plane starts scrolling */
+extern void page_end(uint8_t plane);
+
+/* forget the pages, after lcd_hardware_setup() */
+extern void page_reset();
+
+#endif
@@ -0,0 +1,174 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+/*
+ * Protocol on serial port:
+ *    <0x20 .. 0xff> -> write char - 0x20 to LCD memory
+ * 			(convert ASCII to LCD charset)
+ *    ^A/0x01 byte   -> write byte to LCD memory, literally
+ *    ^B/0x02 byte   -> echo byte back to serial port
+ *    ^C/0x03 lo hi  -> set address pointer (for mem read/write) to addr
+ *    ^D/0x04        -> write status byte to serial port
+ *    ^E/0x05        -> execute lcd hardware init, clear text+graphics
+ *    ^F/0x06 byte   -> set graphic/text combination mode (see hardware.h),
+ *                      first selection of ext. CG clears CG RAM
+ *    ^G/0x07 byte   -> set display mode (text, cursor, blink, gfx. on/off)
+ *    ^H/0x08 byte   -> set cursor width (0..7 -> 1..8 lines)
+ *    ^I/0x09 count bytes... -> bulk transfer count bytes (count=0: 256 byte)
+ *    ^K/0x0b lo hi bytes... -> bulk transfer of lo+256*hi bytes (0: none)
+ *    ^L/0x0c packed...      -> bulk transfer of packed data (see below),
+ *                              up to and including PACK_END
+ *    ^N/0x0e x y flags len chars... -> draw len chars in a proportional
+ *                      font into the graphics plane, top left corner of
+ *                      the text at pixel x,y; flags: DRAW_* mode,
+ *                      DRAW_OPAQUE, TEXT_FONT(n). Chars not in the font
+ *                      are drawn as '?', more than GFX_TEXT_MAX (gfx.h)
+ *                      are dropped. Moves the address pointer.
+ *    ^O/0x0f slot count tiles... -> upload count (0: 256) tiles of 8
+ *                      bytes each to CG RAM, for character codes slot..
+ *                      slot+count-1 (at most 0xff). A tile is 8 rows, top
+ *                      first, bits 5..0 left to right. With the internal
+ *                      CG (^F) codes 0x80..0xff come from CG RAM, with
+ *                      CMD_MODE_EXT_CG all of them. Moves the address
+ *                      pointer.
+ *    ^P/0x10 x y    -> set cursor to x,y
+ *    ^R/0x12 lo hi nlo nhi  -> read back nlo+256*nhi bytes of display RAM
+ *                      from lo+256*hi on; the bytes go back the way the
+ *                      last input came in: serial or GET_REPORT (see below).
+ *                      Input is not eaten until all of them are out.
+ *                      Leaves the address pointer after the range.
+ *    ^T/0x14 byte   -> byte 0: send struct telemetry (telemetry.h) back
+ *                      like ^R does; TELEMETRY_CLEAR: zero the counters
+ *    ^U/0x15 n      -> serial port: switch to BAUD_CLOCK / (n+1) bps (1:
+ *                      1.125M, 2: 750k, 3: 562.5k; 0 is ignored) once the
+ *                      output so far is out. The new rate is on trial:
+ *                      the host follows and sends a ^B at it; without one
+ *                      within 0.5 s the firmware goes back to BAUD_RESET,
+ *                      as it does on reset and on a framing error (a
+ *                      break, or a host still at BAUD_RESET). Harmless
+ *                      over USB.
+ *    ^V/0x16 op args... -> draw into the graphics plane, op is one of
+ *                      DRAW_PLOT.. below | DRAW_* mode, args are pixel
+ *                      coordinates, inclusive, clipped to the screen.
+ *                      Moves the address pointer.
+ *    ^W/0x17 op [line]  -> scroll the text area or graphics plane (op &
+ *                      SCROLL_GRAPHICS) by one line, SCROLL_UP: the new
+ *                      line appears at the bottom, SCROLL_DOWN: on top.
+ *                      With SCROLL_DATA its 40 bytes follow, otherwise
+ *                      it is cleared. The first scroll puts the plane in
+ *                      a ring (see scroll.h), SCROLL_OFF copies it back
+ *                      and restores the home address; ^E ends it, too.
+ *                      ^N and ^V know the ring, ^C addresses don't.
+ *                      Moves the address pointer.
+ *    ^X/0x18 op     -> double buffered graphics plane, and text area with
+ *                      PAGE_TEXT (see page.h): PAGE_FLIP shows the other
+ *                      page, PAGE_COPY then copies it to the hidden one;
+ *                      after PAGE_BACK ^C/^R addresses in the plane, ^N
+ *                      and ^V go to the hidden page, without to the one
+ *                      on screen. Ends scrolling of the plane, ^W ends
+ *                      double buffering; ^E both.
+ *    ^Y/0x19        -> terminal mode (see term.h): everything up to the
+ *                      next ^Y is a VT100 subset on the 40x8 text area,
+ *                      with wrap and scroll, and the graphics plane holds
+ *                      text attributes. Entering ends scrolling and
+ *                      double buffering and clears text and graphics;
+ *                      leaving keeps the text and clears the graphics.
+ */
+
+#define CHAR_NOP     0x00
+#define CHAR_WRITE   0x01	// ^A
+#define CHAR_ECHO    0x02	// ^B
+#define CHAR_ADDR    0x03	// ^C
+#define CHAR_STATUS  0x04	// ^D
+#define CHAR_RESET   0x05	// ^E
+#define CHAR_MODE    0x06	// ^F
+#define CHAR_DISP    0x07	// ^G
+#define CHAR_CURSOR  0x08	// ^H
+#define CHAR_BULK    0x09       // ^I
+#define CHAR_LBULK   0x0b       // ^K
+#define CHAR_PACKED  0x0c       // ^L
+#define CHAR_TEXT    0x0e       // ^N
+#define CHAR_TILES   0x0f       // ^O
+#define CHAR_POS_CURSOR 0x10    // ^P
+#define CHAR_READ    0x12       // ^R
+#define CHAR_TELEMETRY 0x14     // ^T
+#define CHAR_BAUD    0x15       // ^U
+#define CHAR_DRAW    0x16       // ^V
+#define CHAR_SCROLL  0x17       // ^W
+#define CHAR_PAGE    0x18       // ^X
+#define CHAR_TERMINAL 0x19      // ^Y
+
+#define TELEMETRY_CLEAR 0x01
+
+/* ^U: UBRR0 with U2X0 at 18 MHz */
+#define BAUD_CLOCK   2250000UL  /* bps at n = 0 */
+#define BAUD_DEFAULT 19         /* n after reset (io_init()) */
+#define BAUD_RESET   (BAUD_CLOCK / (BAUD_DEFAULT + 1)) /* 112500 bps, the
+                        nearest to 115200 (-2.3%) 18 MHz gives */
+
+#define TILE_SIZE     8     /* bytes per ^O tile */
+#define TILE_INT_CG   0x80  /* first CG RAM code with the internal CG */
+
+/* drawing modes, for ^N and ^V */
+#define DRAW_SET     0x00  /* pixels on */
+#define DRAW_XOR     0x01  /* pixels inverted */
+#define DRAW_CLEAR   0x02  /* pixels off */
+#define DRAW_MODE    0x03
+#define DRAW_OPAQUE  0x04  /* ^N: the background of the text too, the
+                              other way round (not with DRAW_XOR) */
+#define TEXT_FONT(n) ((n) << 4) /* 0: regular, 1: bold (mkfont.py) */
+
+/* ^V primitives, arguments */
+#define DRAW_PLOT    0x00  /* x y */
+#define DRAW_HLINE   0x10  /* x0 x1 y */
+#define DRAW_VLINE   0x20  /* x y0 y1 */
+#define DRAW_LINE    0x30  /* x0 y0 x1 y1 */
+#define DRAW_RECT    0x40  /* x0 y0 x1 y1, outline */
+#define DRAW_FILL    0x50  /* x0 y0 x1 y1, DRAW_CLEAR: clear rectangle */
+#define DRAW_OP      0xf0
+#define DRAW_NARGS(op) ((op) < DRAW_HLINE ? 2 : (op) < DRAW_LINE ? 3 : 4)
+
+/* ^W op */
+#define SCROLL_GRAPHICS 0x01  /* else the text area */
+#define SCROLL_UP    0x00
+#define SCROLL_DOWN  0x02
+#define SCROLL_OFF   0x04
+#define SCROLL_OP    0x06
+#define SCROLL_DATA  0x08  /* UP/DOWN: the new line follows */
+
+/* ^X op */
+#define PAGE_BACK    0x01  /* draw into the hidden page */
+#define PAGE_FLIP    0x02
+#define PAGE_TEXT    0x04  /* the text area, too */
+#define PAGE_COPY    0x08  /* with PAGE_FLIP */
+
+/*
+ * Packed format for display RAM contents (^L, boot splash):
+ *    0x00                -> end of data
+ *    0x01 .. 0x7f  n     -> n literal bytes follow
+ *    0x80 .. 0xbf  b     -> byte b, repeated (n & 0x3f)+2 times
+ *    0xc0 .. 0xff  lo    -> ((n & 0x3f) << 8 | lo)+1 zero bytes
+ */
+
+#define PACK_END     0x00
+#define PACK_REPEAT  0x80
+#define PACK_ZERO    0xc0
+
+/*
+ * Protocol over USB: the byte stream above, sent either as HID feature
+ * reports (SET_REPORT, up to 128 bytes each) or as vendor control-out
+ * requests of up to 65535 bytes (USB_CFG_LONG_TRANSFERS), so a whole
+ * frame is a single transfer:
+ *    bmRequestType 0x40, bRequest USB_RQ_STREAM, wLength = byte count
+ *
+ * ^R readback data is fetched with GET_REPORT (feature, 128 bytes), or
+ * with a vendor control-in request of any length (no hidraw needed):
+ *    bmRequestType 0xc0, bRequest USB_RQ_READBACK, wLength = byte count
+ * Both return the next bytes of the pending range, a short (or empty)
+ * answer means it's done. Sending anything cancels the rest.
+ */
+
+#define USB_RQ_STREAM   0x01
+#define USB_RQ_READBACK 0x02
+
+#endif
@@ -0,0 +1,126 @@
+#include "scroll.h"
+#include "lcd_hardware.h"
+#include "protocol.h"
+#include "page.h"
+
+struct ring {
+	uint16_t home;	/* where the plane is when it doesn't scroll */
+	uint16_t base;	/* ring of 2*lines lines */
+	uint8_t lines;
+	uint8_t cmd;	/* CMD_*_HOME_ADDR */
+	uint8_t on;
+	uint8_t top;	/* ring line on top of the screen, 0..lines */
+};
+
+static struct ring rings[3] = {
+	{ LCD_TEXT_BASE, LCD_TEXT_RING, LCD_TEXT_LINES, CMD_TEXT_HOME_ADDR },
+	{ LCD_GRAPHIC_BASE, LCD_GRAPHIC_RING, LCD_HEIGHT,
+		CMD_GRAPHIC_HOME_ADDR },
+	{ LCD_GRAPHIC_BASE, LCD_ATTRIB_RING, LCD_TEXT_LINES,
+		CMD_GRAPHIC_HOME_ADDR },
+};
+
+/* text lines and graphics lines are both 40 bytes */
+#define LINE LCD_GRAPHIC_COLS
+
+static uint16_t
+ring_line(struct ring *r,uint8_t p){
+	return r->base + p * LINE;
+}
+
+static void
+ring_home(struct ring *r){
+	lcd_command_long(r->cmd,ring_line(r,r->top));
+}
+
+/* write line, 0: clear */
+static void
+line_write(uint16_t addr,const uint8_t *line){
+	uint8_t i;
+	lcd_command_long(CMD_ADDRESS_POINTER,addr);
+	lcd_command(CMD_AUTO_WRITE);
+	for(i=0;i<LINE;i++)
+		lcd_auto_write(line ? line[i] : 0);
+	lcd_auto_reset();
+}
+
+/* Each line is written where it's off screen first, then the home
+   address moves, then the twin is written, which is off screen now. */
+void
+scroll(uint8_t op,const uint8_t *line){
+	scroll_plane(op & SCROLL_GRAPHICS,op,line);
+}
+
+void
+scroll_plane(uint8_t plane,uint8_t op,const uint8_t *line){
+	struct ring *r = &rings[plane];
+	uint8_t p;
+
+	if((op & SCROLL_OP) == SCROLL_OFF){
+		if(!r->on)
+			return;
+		/* src >= dst for the graphics plane, which overlaps its ring */
+		lcd_copy(r->home,ring_line(r,r->top),r->lines * LINE);
+		lcd_command_long(r->cmd,r->home);
+		r->on = 0;
+		return;
+	}
+
+	if(!r->on){ /* both halves of the ring get the plane */
+		if(plane != SCROLL_ATTRIB) /* not double buffered */
+			page_end(plane);
+		if(r->base != r->home)
+			lcd_copy(r->base,r->home,r->lines * LINE);
+		lcd_copy(ring_line(r,r->lines),r->base,r->lines * LINE);
+		r->top = 0;
+		r->on = 1;
+		ring_home(r);
+	}
+
+	if((op & SCROLL_OP) == SCROLL_DOWN){
+		if(r->top == 0){ /* same picture, one ring further */
+			r->top = r->lines;
+			ring_home(r);
+		}
+		p = r->top - 1;
+		line_write(ring_line(r,p),line);
+		r->top--;
+		ring_home(r);
+		line_write(ring_line(r,p + r->lines),line);
+	} else {
+		if(r->top == r->lines){
+			r->top = 0;
+			ring_home(r);
+		}
+		p = r->top + r->lines;
+		line_write(ring_line(r,p),line);
+		r->top++;
+		ring_home(r);
+		line_write(ring_line(r,p - r->lines),line);
+	}
+}
+
+uint16_t
+scroll_addr(uint8_t plane,uint8_t y){
+	struct ring *r = &rings[plane];
+	if(!r->on)
+		return (plane == SCROLL_ATTRIB ? r->home : page_base(plane)) +
+			y * LINE;
+	return ring_line(r,r->top + y);
+}
+
+uint16_t
+scroll_twin(uint8_t plane,uint8_t y){
+	struct ring *r = &rings[plane];
+	uint8_t p = r->top + y;
+	if(!r->on)
+		return 0;
+	return ring_line(r,p < r->lines ? p + r->lines : p - r->lines);
+}
+
+void
+scroll_reset(){
+	rings[SCROLL_TEXT].on = 0;
+	rings[SCROLL_GRAPHICS].on = 0;
+	rings[SCROLL_ATTRIB].on = 0;
+}
@@ -0,0 +1,36 @@
+#ifndef SCROLL_H
+#define SCROLL_H
+
+#include <stdint.h>
+#include "protocol.h"
+
+/* Scrolling by moving the text/graphics home address (^W, protocol.h).
+   While a plane scrolls it lives in a ring of twice its lines (see the
+   memory map in lcd_hardware_setup()); every line is kept twice, V lines
+   apart, so the V lines from the home address on are always the screen
+   and a scroll step is one new line plus a home address update. */
+
+/* planes; SCROLL_GRAPHICS (protocol.h) is the plane bit of the ^W op */
+#define SCROLL_TEXT	0
+#define SCROLL_ATTRIB	2	/* text attributes in the graphics plane,
+				   scrolled along with the text (term.c) */
+
+/* ^W op: SCROLL_UP/DOWN/OFF | plane, line: the new line (40 bytes), or
+   0 to clear it; SCROLL_DATA is ignored here */
+extern void scroll(uint8_t op,const uint8_t *line);
+
+/* the same for any plane, the plane bit of op is ignored */
+extern void scroll_plane(uint8_t plane,uint8_t op,const uint8_t *line);
+
+/* display RAM address of line y of plane, where it's on screen now;
+   SCROLL_ATTRIB is in the graphics plane when it doesn't scroll */
+extern uint16_t scroll_addr(uint8_t plane,uint8_t y);
+
+/* the other copy of line y while plane scrolls, which has to be
+   written too, 0 if there is none */
+extern uint16_t scroll_twin(uint8_t plane,uint8_t y);
+
+/* forget the rings, after lcd_hardware_setup() */
+extern void scroll_reset();
+
+#endif
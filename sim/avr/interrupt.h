@@ -0,0 +1,9 @@
+#ifndef SIM_AVR_INTERRUPT_H
+#define SIM_AVR_INTERRUPT_H
+
+/* the host build has no interrupts, ISRs are called by the bench */
+#define sei()
+#define cli()
+#define ISR(vector, ...) void vector(void)
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef SIM_AVR_IO_H
+#define SIM_AVR_IO_H
+
+/* host-native stand-in for avr-libc's <avr/io.h>: every I/O register the
+   firmware touches is routed through sim_io(), which first brings the
+   T6963C model in sim/hostio.c up to date with the current pin levels
+   and then returns the register's storage. */
+
+#include <stdint.h>
+
+#define _BV(bit) (1 << (bit))
+
+enum sim_reg {
+	SIM_PINB, SIM_DDRB, SIM_PORTB,
+	SIM_PINC, SIM_DDRC, SIM_PORTC,
+	SIM_PIND, SIM_DDRD, SIM_PORTD,
+	SIM_UCSR0A, SIM_UCSR0B, SIM_UCSR0C, SIM_UDR0,
+	SIM_TCCR0A, SIM_TCCR0B,
+	SIM_TCCR1A, SIM_TCCR1B,
+	SIM_NREGS
+};
+
+extern volatile uint8_t *sim_io(uint8_t reg);
+extern volatile uint16_t sim_ubrr0;
+extern uint8_t sim_tcnt0(void);
+extern uint16_t sim_tcnt1(void);
+
+#define PINB   (*sim_io(SIM_PINB))
+#define DDRB   (*sim_io(SIM_DDRB))
+#define PORTB  (*sim_io(SIM_PORTB))
+#define PINC   (*sim_io(SIM_PINC))
+#define DDRC   (*sim_io(SIM_DDRC))
+#define PORTC  (*sim_io(SIM_PORTC))
+#define PIND   (*sim_io(SIM_PIND))
+#define DDRD   (*sim_io(SIM_DDRD))
+#define PORTD  (*sim_io(SIM_PORTD))
+
+#define UCSR0A (*sim_io(SIM_UCSR0A))
+#define UCSR0B (*sim_io(SIM_UCSR0B))
+#define UCSR0C (*sim_io(SIM_UCSR0C))
+#define UDR0   (*sim_io(SIM_UDR0))
+#define UBRR0  sim_ubrr0
+
+#define TCCR0A (*sim_io(SIM_TCCR0A))
+#define TCCR0B (*sim_io(SIM_TCCR0B))
+#define TCNT0  sim_tcnt0() /* read only here */
+
+#define TCCR1A (*sim_io(SIM_TCCR1A))
+#define TCCR1B (*sim_io(SIM_TCCR1B))
+#define TCNT1  sim_tcnt1() /* read only here */
+
+extern uint8_t sim_sreg; /* no interrupts here, just storage */
+#define SREG   sim_sreg
+
+/* UCSR0A */
+#define RXC0   7
+#define TXC0   6
+#define UDRE0  5
+#define FE0    4
+#define DOR0   3
+#define UPE0   2
+#define U2X0   1
+#define MPCM0  0
+/* UCSR0B */
+#define RXCIE0 7
+#define TXCIE0 6
+#define UDRIE0 5
+#define RXEN0  4
+#define TXEN0  3
+#define UCSZ02 2
+#define RXB80  1
+#define TXB80  0
+/* UCSR0C */
+#define UCSZ01 2
+#define UCSZ00 1
+/* TCCR0B */
+#define CS02   2
+#define CS01   1
+#define CS00   0
+/* TCCR1B */
+#define CS12   2
+#define CS11   1
+#define CS10   0
+
+#endif
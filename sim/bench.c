@@ -0,0 +1,325 @@
+/* host-native throughput benchmark for the serial protocol engine
+ *
+ * everavr.c and lcd_hardware.c are compiled for the host against the
+ * register stand-ins in sim/avr/, a model of the T6963C (t6963c.c) sits
+ * on the simulated bus. Byte streams arrive at the serial rate UBRR0
+ * gives, are queued in the input buffer and eaten by input_drain() as
+ * in the main loop, with main_idle() in between. The bench reports how
+ * many bus transactions, status polls and how much modelled time each
+ * input byte costs, and how often the protocol state machine went round
+ * per byte (eat/B: eat_char() calls and eat_buffer() runs). ns/B leaves
+ * out the time spent waiting for the line.
+ *
+ *   ./bench                 run the built-in scenarios
+ *   ./bench file...         replay the given byte streams instead
+ *   -t cmd,data,auto        controller busy times in ns
+ *   -f                      bytes arrive as fast as there is room in
+ *                           the input buffer, not at line rate
+ *   -1                      one eat_char() call per byte instead, as
+ *                           before eat_buffer()
+ *   -u                      feed through the USB path instead: one
+ *                           USB_RQ_STREAM transfer, 8 byte packets into
+ *                           usbFunctionWrite(), INPUT_BATCH bytes eaten
+ *                           per usbPoll() as in the main loop, waiting
+ *                           while flow control NAKs
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "hostio.h"
+#include "streams.h"
+
+static unsigned long bench_eats;
+#define EAT_COUNT(n) (bench_eats += (n))
+#define main everavr_main
+#include "../everavr.c"
+#undef main
+
+/* ---------- bench driver ---------- */
+
+static uint32_t busy_ns[3];
+static int via_usb, per_byte, fill;
+static uint64_t idle_cycles; /* waiting for input, left out of ns/B */
+
+/* what ^R answered, for the scenario's check_rb() */
+static uint8_t rb_buf[LCD_RAM_SIZE];
+static size_t rb_len;
+
+static void
+rb_put(const uint8_t *buf,size_t n){
+	if(n > sizeof(rb_buf) - rb_len)
+		n = sizeof(rb_buf) - rb_len;
+	memcpy(rb_buf+rb_len,buf,n);
+	rb_len += n;
+}
+
+/* ^R: what the main loop and the UDRE interrupt do until it's out,
+   each byte as it went to UDR0 */
+static void
+serial_readback(void){
+	while(readback_left){
+		readback_pump();
+		while(UCSR0B & _BV(UDRIE0)){
+			USART_UDRE_vect();
+			rb_put(&sim_tx[(sim_bus.uart_tx-1) % SIM_TX_SIZE],1);
+		}
+	}
+}
+
+/* ^R over USB: the host fetches 128 byte GET_REPORTs */
+static void
+usb_readback(void){
+	usbRequest_t rq;
+	uint8_t rep[128], got;
+	size_t n;
+
+	memset(&rq,0,sizeof(rq));
+	rq.bmRequestType = USBRQ_TYPE_CLASS | 0x80;
+	rq.bRequest = USBRQ_HID_GET_REPORT;
+	rq.wLength.word = sizeof(rep);
+	while(usbFunctionSetup((uchar *)&rq) == USB_NO_MSG){
+		for(n=0;n<sizeof(rep);n+=got)
+			if((got = usbFunctionRead(rep+n,8)) < 8){
+				n += got;
+				break;
+			}
+		rb_put(rep,n);
+	}
+}
+
+/* the main loop with nothing to eat until cycle t, in steps short
+   enough for main_idle() to see its timeout */
+static void
+wait_until(uint64_t t){
+	uint64_t d;
+	while(sim_cycles < t){
+		d = t - sim_cycles;
+		if(d > 256 * IDLE_TICKS)
+			d = 256 * IDLE_TICKS;
+		sim_cycles += d;
+		idle_cycles += d;
+		main_idle(0);
+	}
+}
+
+/* the end of a stream: until main_idle() has done its work */
+static void
+wait_idle(void){
+	wait_until(sim_cycles + 256 * (IDLE_TICKS + 2));
+}
+
+/* the control-out transfer as V-USB hands it to us */
+static void
+usb_feed(const uint8_t *buf,size_t len){
+	usbRequest_t rq;
+	size_t i, n;
+
+	memset(&rq,0,sizeof(rq));
+	rq.bmRequestType = USBRQ_TYPE_VENDOR;
+	rq.bRequest = USB_RQ_STREAM;
+	for(i=0;i<len;i+=0xffff){
+		rq.wLength.word = len-i > 0xffff ? 0xffff : len-i;
+		usbFunctionSetup((uchar *)&rq);
+		for(n=0;n<rq.wLength.word;n+=8){
+			while(usbAllRequestsAreDisabled()){ /* NAK */
+				input_drain(INPUT_BATCH);
+				flow_go();
+			}
+			usbFunctionWrite((uchar *)buf+i+n,
+				rq.wLength.word-n < 8 ? rq.wLength.word-n : 8);
+			main_idle(input_drain(INPUT_BATCH) != 0);
+		}
+		usb_readback();
+	}
+	while(input_drain(INPUT_BATCH) || readback_left)
+		usb_readback();
+	wait_idle();
+}
+
+/* the UART side: a byte every 10 bit times at UBRR0 (U2X0: 8 cycles a
+   bit) while the input buffer has room, else the host waits for RTS */
+static void
+serial_feed(const uint8_t *buf,size_t len){
+	uint64_t byte = 80 * (UBRR0 + 1), next = sim_cycles;
+	size_t i = 0;
+	uint8_t busy;
+
+	while(i < len || input_tail != input_head){
+		while(i < len && (fill || next <= sim_cycles)){
+			if(!input_free()){ /* stopped, one byte time to resume */
+				next = sim_cycles + byte;
+				break;
+			}
+			input_put(buf[i++],0);
+			next += byte;
+		}
+		busy = input_drain(INPUT_BATCH) != 0;
+		serial_readback();
+		main_idle(busy);
+		if(!busy && i < len)
+			wait_until(next);
+	}
+	wait_idle();
+}
+
+static void
+boot(void){
+	sim_reset();
+	if(busy_ns[0]){
+		sim_lcd.busy_cmd_ns  = busy_ns[0];
+		sim_lcd.busy_data_ns = busy_ns[1];
+		sim_lcd.busy_auto_ns = busy_ns[2];
+	}
+	io_init();
+	lcd_hardware_init();
+	scroll_reset(); /* static state of the last scenario, too */
+	page_reset();
+	main_idle(1);
+	sim_bus_sync();
+	global_serport_state = serport_idle;
+	global_serport_data = 0;
+}
+
+static void
+header(void){
+	printf("%-12s %7s %8s %8s %8s %8s %9s %7s %7s %9s %6s %5s\n",
+		"scenario","bytes","cmd_wr","data_wr","polls","busy","ctrl_us",
+		"txn/B","poll/B","ns/B","eat/B","check");
+}
+
+/* 1 if a check failed */
+static int
+run(const char *name,const uint8_t *buf,size_t len,
+		int (*check)(const uint8_t *ram),
+		int (*check_rb)(const uint8_t *rb,size_t len)){
+	struct t6963c_stats *st = &sim_lcd.stats;
+	struct lcdbus *bs = &sim_lcdbus;
+	unsigned long txn;
+	uint64_t t0;
+	size_t i;
+	int fail;
+
+	boot();
+	memset(st,0,sizeof(*st));
+	bs->writes = bs->reads = bs->contention = 0;
+	bench_eats = 0;
+	idle_cycles = 0;
+	rb_len = 0;
+	t0 = sim_now_ns();
+
+	if(via_usb)
+		usb_feed(buf,len);
+	else if(per_byte){
+		for(i=0;i<len;i++){
+			eat_char(buf[i]);
+			serial_readback();
+		}
+		wait_idle();
+	} else
+		serial_feed(buf,len);
+	sim_bus_sync();
+
+	fail = (check && check(sim_lcd.ram))
+		|| (check_rb && check_rb(rb_buf,rb_len));
+	txn = bs->writes + bs->reads;
+	printf("%-12s %7zu %8lu %8lu %8lu %8lu %9.1f %7.2f %7.2f %9.1f %6.3f %5s\n",
+		name,len,st->cmd_writes,st->data_writes,st->status_reads,
+		st->busy_polls,st->busy_ns/1000.0,
+		(double)txn/len,(double)st->status_reads/len,
+		(double)(sim_now_ns()-t0-idle_cycles*1000000000ULL/F_CPU)/len,
+		(double)bench_eats/len,
+		fail ? "FAIL" : check || check_rb ? "ok" : "-");
+	if(st->violations || bs->contention)
+		printf("%-12s   !! %lu accesses while busy, %lu bus contentions\n",
+			"",st->violations,bs->contention);
+	return fail;
+}
+
+static int
+replay(const char *fn){
+	struct stream s = { 0 };
+	FILE *f;
+	int c;
+
+	if(!(f = fopen(fn,"rb"))){
+		perror(fn);
+		return 1;
+	}
+	while((c = getc(f)) != EOF)
+		stream_put(&s,c);
+	fclose(f);
+	if(s.len)
+		run(fn,s.buf,s.len,NULL,NULL);
+	free(s.buf);
+	return 0;
+}
+
+int
+main(int argc,char **argv){
+	unsigned i;
+	int opt, ret=0;
+
+	while((opt = getopt(argc,argv,"t:uf1")) != -1){
+		switch(opt){
+		case 't':
+			if(sscanf(optarg,"%u,%u,%u",
+			    &busy_ns[0],&busy_ns[1],&busy_ns[2]) != 3
+			    || !busy_ns[0] || !busy_ns[1] || !busy_ns[2]){
+				fprintf(stderr,"%s: -t wants cmd,data,auto ns\n",
+					argv[0]);
+				return 1;
+			}
+			break;
+		case 'u':
+			via_usb = 1;
+			break;
+		case 'f':
+			fill = 1;
+			break;
+		case '1':
+			per_byte = 1;
+			break;
+		default:
+			fprintf(stderr,"usage: %s [-t cmd,data,auto] [-u] [-f] [-1] "
+				"[file...]\n",
+				argv[0]);
+			return 1;
+		}
+	}
+
+	printf("# F_CPU %lu Hz, %d cycles per I/O access; "
+		"controller busy cmd/data/auto %u/%u/%u ns\n",
+		(unsigned long)F_CPU,SIM_CYCLES_PER_IO,
+		busy_ns[0] ? busy_ns[0] : T6963C_BUSY_CMD_NS,
+		busy_ns[1] ? busy_ns[1] : T6963C_BUSY_DATA_NS,
+		busy_ns[2] ? busy_ns[2] : T6963C_BUSY_AUTO_NS);
+	sim_reset();
+	io_init();
+	lcd_hardware_setup();
+	lcd_unpack_P(LCD_TEXT_BASE,splash);
+	sim_bus_sync();
+	printf("# boot (setup + splash): %lu bus cycles, %.1f us\n",
+		sim_lcdbus.writes + sim_lcdbus.reads,sim_now_ns()/1000.0);
+	if(!via_usb && !per_byte && !fill)
+		printf("# serial at %lu bps, ns/B without the wait for it\n",
+			BAUD_CLOCK / (UBRR0 + 1));
+	header();
+
+	if(optind < argc){
+		for(i=optind;i<(unsigned)argc;i++)
+			ret |= replay(argv[i]);
+		return ret;
+	}
+
+	for(i=0;i<nscenarios;i++){
+		struct stream s = { 0 };
+		scenarios[i].gen(&s);
+		ret |= run(scenarios[i].name,s.buf,s.len,scenarios[i].check,
+			scenarios[i].check_rb);
+		free(s.buf);
+	}
+	return ret;
+}
@@ -0,0 +1,101 @@
+#include "hostio.h"
+
+#include <avr/io.h>
+#include <string.h>
+
+struct t6963c sim_lcd;
+struct lcdbus sim_lcdbus = { &sim_lcd };
+struct sim_bus_stats sim_bus;
+uint64_t sim_cycles;
+uint8_t sim_tx[SIM_TX_SIZE];
+
+volatile uint16_t sim_ubrr0;
+uint8_t sim_sreg;
+
+static volatile uint8_t sim_regs[SIM_NREGS];
+static volatile uint8_t sim_tx_slot;
+static uint8_t sim_rx_pending, sim_rx_data;
+
+uint64_t
+sim_now_ns(void){
+	return sim_cycles * 1000000000ULL / F_CPU;
+}
+
+void
+sim_bus_sync(void){
+	uint8_t port[LCDBUS_NPORTS], ddr[LCDBUS_NPORTS];
+
+	port[LCDBUS_B] = sim_regs[SIM_PORTB]; ddr[LCDBUS_B] = sim_regs[SIM_DDRB];
+	port[LCDBUS_C] = sim_regs[SIM_PORTC]; ddr[LCDBUS_C] = sim_regs[SIM_DDRC];
+	port[LCDBUS_D] = sim_regs[SIM_PORTD]; ddr[LCDBUS_D] = sim_regs[SIM_DDRD];
+	lcdbus_sync(&sim_lcdbus,port,ddr,sim_now_ns());
+
+	/* inputs read back what's on the pins, outputs what we drive */
+	sim_regs[SIM_PINB] = port[LCDBUS_B];
+	sim_regs[SIM_PINC] = (port[LCDBUS_C] & ddr[LCDBUS_C])
+		| (sim_lcdbus.drive[LCDBUS_C] & ~ddr[LCDBUS_C]);
+	sim_regs[SIM_PIND] = (port[LCDBUS_D] & ddr[LCDBUS_D])
+		| (sim_lcdbus.drive[LCDBUS_D] & ~ddr[LCDBUS_D]);
+}
+
+volatile uint8_t *
+sim_io(uint8_t reg){
+	sim_bus.io_accesses++;
+	sim_cycles += SIM_CYCLES_PER_IO;
+	sim_bus_sync();
+
+	switch(reg){
+	case SIM_UCSR0A: /* transmitter is infinitely fast */
+		sim_regs[reg] |= _BV(UDRE0);
+		if(sim_rx_pending)
+			sim_regs[reg] |= _BV(RXC0);
+		else
+			sim_regs[reg] &= ~_BV(RXC0);
+		break;
+	case SIM_UDR0:
+		/* the firmware only reads UDR0 with RXC0 set, so anything
+		   else must be a write: hand out a fresh slot in sim_tx[] */
+		if(sim_rx_pending){
+			sim_rx_pending = 0;
+			sim_regs[reg] = sim_rx_data;
+			break;
+		}
+		sim_bus.uart_tx++;
+		return &sim_tx[sim_tx_slot++];
+	}
+	return &sim_regs[reg];
+}
+
+/* Timer0/1 count modelled cycles, prescaler from CSx2..CSx0 */
+static const uint16_t sim_tdiv[8] = { 0, 1, 8, 64, 256, 1024, 0, 0 };
+
+uint8_t
+sim_tcnt0(void){
+	uint16_t d = sim_tdiv[*sim_io(SIM_TCCR0B) & 7];
+	return d ? sim_cycles / d : 0;
+}
+
+uint16_t
+sim_tcnt1(void){
+	uint16_t d = sim_tdiv[*sim_io(SIM_TCCR1B) & 7];
+	return d ? sim_cycles / d : 0;
+}
+
+void
+sim_uart_rx(uint8_t c){
+	sim_rx_data = c;
+	sim_rx_pending = 1;
+}
+
+void
+sim_reset(void){
+	memset((void *)sim_regs,0,sizeof(sim_regs));
+	memset(&sim_bus,0,sizeof(sim_bus));
+	memset(&sim_lcdbus,0,sizeof(sim_lcdbus));
+	sim_lcdbus.lcd = &sim_lcd;
+	sim_tx_slot = 0;
+	sim_rx_pending = 0;
+	sim_cycles = 0;
+	sim_lcd.busy_cmd_ns = sim_lcd.busy_data_ns = sim_lcd.busy_auto_ns = 0;
+	t6963c_reset(&sim_lcd,1);
+}
@@ -0,0 +1,42 @@
+#ifndef HOSTIO_H
+#define HOSTIO_H
+
+/* glue between the register stand-ins in sim/avr/io.h and the T6963C
+   model: pin levels are evaluated (lcdbus_sync) on every register
+   access. */
+
+#include <stdint.h>
+#include "t6963c.h"
+#include "lcdbus.h"
+
+/* every I/O register access is accounted as this many AVR cycles,
+   sbi/cbi/in/out-ish; there is no model of the code in between */
+#define SIM_CYCLES_PER_IO	2
+
+struct sim_bus_stats {
+	unsigned long io_accesses;  /* register accesses (SIM_CYCLES_PER_IO) */
+	unsigned long uart_tx;      /* bytes written to UDR0 */
+};
+
+extern struct t6963c sim_lcd;
+extern struct lcdbus sim_lcdbus;
+extern struct sim_bus_stats sim_bus;
+extern uint64_t sim_cycles;
+
+/* UART bytes written by the firmware (last SIM_TX_SIZE of them) */
+#define SIM_TX_SIZE 256
+extern uint8_t sim_tx[SIM_TX_SIZE];
+
+/* power-on state: registers zero, controller reset */
+extern void sim_reset(void);
+
+/* evaluate the pins once more, e.g. after the last access of a run */
+extern void sim_bus_sync(void);
+
+/* make c available in UDR0 and set RXC0, as if it had just arrived */
+extern void sim_uart_rx(uint8_t c);
+
+/* modelled time in ns since sim_reset() */
+extern uint64_t sim_now_ns(void);
+
+#endif
@@ -0,0 +1,50 @@
+#include "lcdbus.h"
+#include "lcd_hardware.h"
+
+/* data bus halves: DLO is on port C, DHI on port D (lcd_hardware.h) */
+
+/* the lines with 10k pull-ups on the LCD PCB read high when undriven */
+static uint8_t
+pin_level(uint8_t port,uint8_t ddr,uint8_t mask){
+	if(ddr & mask)
+		return !!(port & mask);
+	return 1;
+}
+
+void
+lcdbus_sync(struct lcdbus *b,const uint8_t port[LCDBUS_NPORTS],
+		const uint8_t ddr[LCDBUS_NPORTS],uint64_t now){
+	uint8_t cs_low = !pin_level(port[LCDBUS_B],ddr[LCDBUS_B],PORTB_CS);
+	uint8_t wr_low = !pin_level(port[LCDBUS_B],ddr[LCDBUS_B],PORTB_WR);
+	uint8_t rd_low = !pin_level(port[LCDBUS_B],ddr[LCDBUS_B],PORTB_RD);
+	uint8_t cd     =  pin_level(port[LCDBUS_D],ddr[LCDBUS_D],PORTD_CD);
+
+	/* controller samples D0..D7 on the rising edge of \WR */
+	if(b->prev_wr_low && !wr_low && cs_low){
+		uint8_t data = LCD_FROM_PORT(port[LCDBUS_C],DLO)
+			| LCD_FROM_PORT(port[LCDBUS_D],DHI);
+		b->writes++;
+		if((ddr[LCDBUS_C] & LCD_PORT_MASK(DLO)) != LCD_PORT_MASK(DLO)
+		    || (ddr[LCDBUS_D] & LCD_PORT_MASK(DHI)) != LCD_PORT_MASK(DHI))
+			b->contention++;
+		t6963c_write(b->lcd,cd,data,now);
+		b->last_ns = now;
+	}
+
+	/* ... and drives them from the falling edge of \RD on */
+	if(rd_low && !b->prev_rd_low && cs_low){
+		uint8_t data = t6963c_read(b->lcd,cd,now);
+		b->reads++;
+		if((ddr[LCDBUS_C] & LCD_PORT_MASK(DLO))
+		    || (ddr[LCDBUS_D] & LCD_PORT_MASK(DHI)))
+			b->contention++;
+		b->drive[LCDBUS_C] = LCD_TO_PORT(data,DLO);
+		b->drive[LCDBUS_D] = LCD_TO_PORT(data,DHI);
+		b->last_ns = now;
+	}
+	if(!rd_low)
+		b->drive[LCDBUS_C] = b->drive[LCDBUS_D] = 0;
+
+	b->prev_wr_low = wr_low;
+	b->prev_rd_low = rd_low;
+}
@@ -0,0 +1,31 @@
+#ifndef LCDBUS_H
+#define LCDBUS_H
+
+/* the wires between the mega168 and the T6963C model: turns AVR port
+   and direction registers into controller bus cycles (\WR rising edge,
+   \RD falling edge) and tells which data pins the controller drives.
+   Shared by the host-native bench and the simavr bench. */
+
+#include <stdint.h>
+#include "t6963c.h"
+
+enum { LCDBUS_B, LCDBUS_C, LCDBUS_D, LCDBUS_NPORTS };
+
+struct lcdbus {
+	struct t6963c *lcd;
+	uint8_t prev_wr_low, prev_rd_low;
+	uint8_t drive[LCDBUS_NPORTS];  /* pins currently driven by the LCD */
+
+	unsigned long writes;      /* \WR strobes seen with \CS low */
+	unsigned long reads;       /* \RD strobes seen with \CS low */
+	unsigned long contention;  /* strobes with wrong data bus direction */
+	uint64_t last_ns;          /* time of the last bus cycle */
+};
+
+/* look at the pins at time now (ns); afterwards b->drive[] holds the
+   levels the controller puts on the data bus (only valid for pins the
+   AVR has configured as inputs) */
+extern void lcdbus_sync(struct lcdbus *b,const uint8_t port[LCDBUS_NPORTS],
+	const uint8_t ddr[LCDBUS_NPORTS],uint64_t now);
+
+#endif
@@ -0,0 +1,376 @@
+/* cycle-accurate firmware benchmark: runs the real everavr.bin under simavr
+ *
+ * The T6963C model (t6963c.c) is wired to the pins listed at the top of
+ * everavr.c through lcdbus.c, exactly as in the host-native bench, but
+ * here the AVR core, the USART and usbPoll() are the real thing. A UART
+ * stimulus injects the bench streams (streams.c) at line rate; the bench
+ * reports achieved bytes/sec, RX bytes that would have been overrun and
+ * the cycles the firmware needs per protocol command.
+ *
+ * Unverified: compiled only, never linked against simavr or run.
+ *
+ *   ./simavr_bench [-b baud] [-n] [-t cmd,data,auto] everavr.bin [file...]
+ *
+ * The stimulus runs at the rate the firmware set up after boot, from
+ * UBRR0 and U2X0 (simavr paces reception by them, a faster stimulus
+ * would only pile up in its FIFO); -b overrides it, to see what a host
+ * at the wrong rate does. A ^U in a stream is not followed.
+ *
+ * The stimulus holds off while the firmware raises RTS (PB3) like a
+ * host with CTS handshake would; -n ignores it, to see what gets lost
+ * without flow control.
+ *
+ * Overruns: the mega168 USART holds two received bytes plus the one in
+ * the shift register; a byte that completes while two unread ones are
+ * pending is counted as dropped and not handed to the firmware (simavr
+ * itself would just queue it).
+ *
+ * Cycles per command: for every byte, the cycles from the firmware
+ * picking it out of UDR0 to its last LCD bus cycle before it reads the
+ * next byte, summed per stream and divided by the number of commands.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sim_avr.h"
+#include "sim_elf.h"
+#include "avr_ioport.h"
+#include "avr_uart.h"
+
+#include "t6963c.h"
+#include "lcdbus.h"
+#include "streams.h"
+#include "protocol.h"
+#include "lcd_hardware.h"
+
+/* mega168 data space addresses */
+#define REG_DDRB   0x24
+#define REG_PORTB  0x25
+#define REG_DDRC   0x27
+#define REG_PORTC  0x28
+#define REG_DDRD   0x2a
+#define REG_PORTD  0x2b
+#define REG_UCSR0A 0xc0
+#define REG_UBRR0L 0xc4
+#define REG_UBRR0H 0xc5
+#define BIT_RXC0   0x80
+#define BIT_U2X0   0x02
+#define BIT_RTS    0x08 /* PB3 */
+
+/* give up if the firmware stops touching the LCD for this long */
+#define QUIET_NS   2000000ULL
+
+static avr_t *avr;
+static struct t6963c lcd;
+static struct lcdbus bus = { &lcd };
+static avr_irq_t *pin_irq[LCDBUS_NPORTS][8];
+static avr_irq_t *uart_in;
+static unsigned long uart_tx;
+static int ignore_rts;
+
+static uint64_t
+now_ns(void){
+	return avr->cycle * 1000000000ULL / avr->frequency;
+}
+
+/* evaluate the LCD pins after every instruction, drive the data lines
+   the controller puts on the bus */
+static void
+bus_sync(void){
+	static uint8_t driven[LCDBUS_NPORTS];
+	uint8_t port[LCDBUS_NPORTS], ddr[LCDBUS_NPORTS];
+	int p,i;
+
+	port[LCDBUS_B] = avr->data[REG_PORTB]; ddr[LCDBUS_B] = avr->data[REG_DDRB];
+	port[LCDBUS_C] = avr->data[REG_PORTC]; ddr[LCDBUS_C] = avr->data[REG_DDRC];
+	port[LCDBUS_D] = avr->data[REG_PORTD]; ddr[LCDBUS_D] = avr->data[REG_DDRD];
+	lcdbus_sync(&bus,port,ddr,now_ns());
+
+	for(p=LCDBUS_C;p<=LCDBUS_D;p++){
+		uint8_t mask = (p == LCDBUS_C) ? LCD_PORT_MASK(DLO)
+			: LCD_PORT_MASK(DHI);
+		uint8_t v = bus.drive[p] | (bus.prev_rd_low ? 0 : mask);
+		if(v == driven[p])
+			continue;
+		for(i=0;i<8;i++)
+			if(mask & (1<<i))
+				avr_raise_irq(pin_irq[p][i],!!(v & (1<<i)));
+		driven[p] = v;
+	}
+}
+
+static void
+uart_out_hook(struct avr_irq_t *irq,uint32_t value,void *param){
+	uart_tx++;
+}
+
+struct result {
+	unsigned long injected, dropped, consumed;
+	uint64_t active_cycles;
+	uint64_t start_cycle, end_cycle;
+};
+
+/* run the AVR, feeding buf[] into the UART every cycles_per_byte */
+static int
+feed(const uint8_t *buf,size_t len,uint64_t cycles_per_byte,
+		struct result *r){
+	uint64_t next = avr->cycle;
+	uint64_t open_cycle = 0, bus_cycle = 0;
+	unsigned long bus_txn = bus.writes + bus.reads;
+	uint8_t rxc = avr->data[REG_UCSR0A] & BIT_RXC0, open = 0;
+	size_t pos = 0;
+
+	memset(r,0,sizeof(*r));
+	r->start_cycle = avr->cycle;
+
+	for(;;){
+		int state = avr_run(avr);
+		if(state == cpu_Done || state == cpu_Crashed){
+			fprintf(stderr,"simavr: cpu stopped (%d)\n",state);
+			return 1;
+		}
+		bus_sync();
+
+		if(bus.writes + bus.reads != bus_txn){
+			bus_txn = bus.writes + bus.reads;
+			bus_cycle = avr->cycle;
+		}
+
+		/* RXC0 1->0: firmware took a byte out of UDR0 */
+		if(rxc && !(avr->data[REG_UCSR0A] & BIT_RXC0)){
+			if(open && bus_cycle > open_cycle)
+				r->active_cycles += bus_cycle - open_cycle;
+			open = 1;
+			open_cycle = avr->cycle;
+			r->consumed++;
+		}
+		rxc = avr->data[REG_UCSR0A] & BIT_RXC0;
+
+		if(pos < len && avr->cycle >= next && !ignore_rts
+		    && (avr->data[REG_PORTB] & BIT_RTS))
+			next = avr->cycle; /* host's CTS: hold off */
+		else if(pos < len && avr->cycle >= next){
+			if(r->injected - r->consumed >= 2)
+				r->dropped++;
+			else {
+				avr_raise_irq(uart_in,buf[pos]);
+				r->injected++;
+			}
+			pos++;
+			next += cycles_per_byte;
+		}
+
+		if(pos == len && r->consumed == r->injected
+		    && now_ns() - bus.last_ns > QUIET_NS
+		    && avr->cycle > next)
+			break;
+	}
+	if(open && bus_cycle > open_cycle)
+		r->active_cycles += bus_cycle - open_cycle;
+	r->end_cycle = bus_cycle > r->start_cycle ? bus_cycle : avr->cycle;
+	return 0;
+}
+
+/* number of protocol commands in a stream, for the per-command figure */
+static unsigned long
+count_commands(const uint8_t *buf,size_t len){
+	unsigned long n = 0;
+	size_t i = 0;
+	while(i < len){
+		uint8_t c = buf[i];
+		n++;
+		if(c >= 0x20){ i++; continue; }
+		switch(c){
+		case CHAR_WRITE: case CHAR_ECHO: case CHAR_MODE:
+		case CHAR_DISP: case CHAR_CURSOR: case CHAR_TELEMETRY:
+		case CHAR_PAGE: case CHAR_BAUD:
+			i += 2; break;
+		case CHAR_ADDR: case CHAR_POS_CURSOR:
+			i += 3; break;
+		case CHAR_READ:
+			i += 5; break;
+		case CHAR_BULK:
+			i += 2 + (i+1 < len ? (buf[i+1] ? buf[i+1] : 256) : 0);
+			break;
+		case CHAR_LBULK:
+			i += 3 + (i+2 < len ? buf[i+1] | (buf[i+2] << 8) : 0);
+			break;
+		case CHAR_TEXT:
+			i += 5 + (i+4 < len ? buf[i+4] : 0);
+			break;
+		case CHAR_DRAW:
+			i += 2 + (i+1 < len ? DRAW_NARGS(buf[i+1] & DRAW_OP) : 0);
+			break;
+		case CHAR_SCROLL:
+			i += 2 + (i+1 < len && (buf[i+1] & SCROLL_DATA) ?
+				LCD_GRAPHIC_COLS : 0);
+			break;
+		case CHAR_TILES:
+			i += 3 + (i+2 < len ? (buf[i+2] ? buf[i+2] : 256) : 0)
+				* TILE_SIZE;
+			break;
+		case CHAR_TERMINAL: /* one command up to the next ^Y */
+			for(i++;i < len && buf[i] != CHAR_TERMINAL;i++)
+				;
+			i++;
+			break;
+		case CHAR_PACKED:
+			for(i++;i < len && buf[i] != PACK_END;)
+				i += buf[i] < PACK_REPEAT ? 1 + buf[i] : 2;
+			i++;
+			break;
+		default:
+			i++;
+		}
+	}
+	return n;
+}
+
+static void
+report(const char *name,const uint8_t *buf,size_t len,
+		const struct result *r,int (*check)(const uint8_t *ram)){
+	double secs = (double)(r->end_cycle - r->start_cycle) / avr->frequency;
+	unsigned long ncmd = count_commands(buf,len);
+
+	printf("%-12s %7zu %7lu %10.0f %10.0f %10.1f %10.1f %5s\n",
+		name,len,r->dropped,
+		secs > 0 ? (r->injected - r->dropped) / secs : 0.0,
+		secs * 1e6,
+		(double)r->active_cycles / (ncmd ? ncmd : 1),
+		(double)r->active_cycles / (r->consumed ? r->consumed : 1),
+		check ? (check(lcd.ram) ? "FAIL" : "ok") : "-");
+}
+
+static int
+load(struct stream *s,const char *fn){
+	FILE *f;
+	int c;
+	if(!(f = fopen(fn,"rb"))){
+		perror(fn);
+		return 1;
+	}
+	while((c = getc(f)) != EOF)
+		stream_put(s,c);
+	fclose(f);
+	return 0;
+}
+
+int
+main(int argc,char **argv){
+	elf_firmware_t fw;
+	uint32_t flags = 0;
+	unsigned long baud = 0, ubrr, bit;
+	uint64_t cycles_per_byte;
+	struct result r;
+	int opt, p, i, ret = 0;
+
+	memset(&lcd,0,sizeof(lcd));
+	while((opt = getopt(argc,argv,"b:nt:")) != -1){
+		switch(opt){
+		case 'b':
+			baud = strtoul(optarg,NULL,0);
+			break;
+		case 'n':
+			ignore_rts = 1;
+			break;
+		case 't':
+			if(sscanf(optarg,"%u,%u,%u",&lcd.busy_cmd_ns,
+			    &lcd.busy_data_ns,&lcd.busy_auto_ns) != 3){
+				fprintf(stderr,"%s: -t wants cmd,data,auto ns\n",
+					argv[0]);
+				return 1;
+			}
+			break;
+		default:
+			optind = argc;
+			break;
+		}
+	}
+	if(optind >= argc){
+		fprintf(stderr,"usage: %s [-b baud] [-n] [-t cmd,data,auto] "
+			"everavr.bin [file...]\n",argv[0]);
+		return 1;
+	}
+
+	memset(&fw,0,sizeof(fw));
+	if(elf_read_firmware(argv[optind],&fw)){
+		fprintf(stderr,"%s: can't read %s\n",argv[0],argv[optind]);
+		return 1;
+	}
+	if(!fw.frequency)
+		fw.frequency = F_CPU;
+	if(!(avr = avr_make_mcu_by_name("atmega168"))){
+		fprintf(stderr,"%s: simavr has no atmega168\n",argv[0]);
+		return 1;
+	}
+	avr_init(avr);
+	avr_load_firmware(avr,&fw);
+
+	t6963c_reset(&lcd,1);
+	for(p=LCDBUS_C;p<=LCDBUS_D;p++)
+		for(i=0;i<8;i++)
+			pin_irq[p][i] = avr_io_getirq(avr,
+				AVR_IOCTL_IOPORT_GETIRQ(p == LCDBUS_C ? 'C' : 'D'),i);
+
+	/* the UART is ours, not stdout's */
+	avr_ioctl(avr,AVR_IOCTL_UART_GET_FLAGS('0'),&flags);
+	flags &= ~AVR_UART_FLAG_STDIO;
+	avr_ioctl(avr,AVR_IOCTL_UART_SET_FLAGS('0'),&flags);
+	uart_in = avr_io_getirq(avr,AVR_IOCTL_UART_GETIRQ('0'),UART_IRQ_INPUT);
+	avr_irq_register_notify(
+		avr_io_getirq(avr,AVR_IOCTL_UART_GETIRQ('0'),UART_IRQ_OUTPUT),
+		uart_out_hook,NULL);
+
+	/* power-up: lcd_hardware_init() and the greeting, no input yet */
+	if(feed(NULL,0,0,&r))
+		return 1;
+
+	/* 8N1: ten bit times per byte, a bit is 8 (U2X0) or 16 cycles
+	   per UBRR0 count */
+	ubrr = avr->data[REG_UBRR0L] | (avr->data[REG_UBRR0H] & 0x0f) << 8;
+	bit = (avr->data[REG_UCSR0A] & BIT_U2X0 ? 8 : 16) * (ubrr + 1);
+	cycles_per_byte = 10 * (baud ? avr->frequency / baud : bit);
+	printf("# %s, %lu Hz, firmware at %lu bps (UBRR0 %lu%s), stimulus "
+		"%lu bps; boot took %.1f ms\n",argv[optind],
+		(unsigned long)avr->frequency,
+		(unsigned long)avr->frequency / bit,ubrr,
+		avr->data[REG_UCSR0A] & BIT_U2X0 ? " U2X0" : "",
+		(unsigned long)(avr->frequency * 10 / cycles_per_byte),
+		1e3 * avr->cycle / avr->frequency);
+	printf("%-12s %7s %7s %10s %10s %10s %10s %5s\n",
+		"scenario","bytes","dropped","bytes/s","us",
+		"cyc/cmd","cyc/byte","check");
+
+	if(optind+1 < argc){
+		for(i=optind+1;i<argc;i++){
+			struct stream s = { 0 };
+			if(load(&s,argv[i])){
+				ret = 1;
+				continue;
+			}
+			if(!s.len || feed(s.buf,s.len,cycles_per_byte,&r))
+				ret = 1;
+			else
+				report(argv[i],s.buf,s.len,&r,NULL);
+			free(s.buf);
+		}
+		return ret;
+	}
+
+	for(i=0;i<(int)nscenarios;i++){
+		struct stream s = { 0 };
+		scenarios[i].gen(&s);
+		if(feed(s.buf,s.len,cycles_per_byte,&r))
+			return 1;
+		report(scenarios[i].name,s.buf,s.len,&r,scenarios[i].check);
+		ret |= scenarios[i].check && scenarios[i].check(lcd.ram);
+		free(s.buf);
+	}
+	printf("# uart tx %lu bytes, lcd bus %lu writes %lu reads, "
+		"%lu accesses while busy\n",
+		uart_tx,bus.writes,bus.reads,lcd.stats.violations);
+	return ret;
+}
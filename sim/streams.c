@@ -0,0 +1,726 @@
+#include "streams.h"
+#include "lcd_hardware.h"
+#include "protocol.h"
+
+#include <avr/pgmspace.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "font8.h"
+
+void
+stream_put(struct stream *s,uint8_t c){
+	if(s->len == s->size){
+		s->size = s->size ? 2*s->size : 1024;
+		s->buf = realloc(s->buf,s->size);
+		if(!s->buf){
+			perror("realloc");
+			exit(1);
+		}
+	}
+	s->buf[s->len++] = c;
+}
+
+static void
+put_addr(struct stream *s,uint16_t addr){
+	stream_put(s,CHAR_ADDR);
+	stream_put(s,addr & 0xff);
+	stream_put(s,addr >> 8);
+}
+
+/* a recognizable test pattern for the graphics plane */
+static uint8_t
+pattern(unsigned i){
+	return (i*7 + (i>>5)) & 0x3f;
+}
+
+/* ---------- built-in scenarios ---------- */
+
+/* fill the 40x8 text area with printable characters */
+static void
+gen_text(struct stream *s){
+	unsigned i;
+	put_addr(s,LCD_TEXT_BASE);
+	for(i=0;i<320;i++)
+		stream_put(s,0x20 + i%95);
+}
+
+static int
+check_text(const uint8_t *ram){
+	unsigned i;
+	for(i=0;i<320;i++)
+		if(ram[LCD_TEXT_BASE+i] != i%95)
+			return 1;
+	return 0;
+}
+
+/* bytes 0xa0..0xff are codes 0x80..0xdf, their glyphs come from CG RAM
+   even with the internal CG: blank until ^O puts tiles there */
+static void
+gen_high(struct stream *s){
+	unsigned i;
+	put_addr(s,LCD_TEXT_BASE);
+	for(i=0xa0;i<=0xff;i++)
+		stream_put(s,i);
+}
+
+static int
+check_high(const uint8_t *ram){
+	unsigned i;
+	for(i=0;i<=0xff-0xa0;i++)
+		if(ram[LCD_TEXT_BASE+i] != 0x80+i)
+			return 1;
+	for(i=LCD_CGRAM_HIGH;i<LCD_RAM_SIZE;i++)
+		if(ram[i])
+			return 1;
+	return 0;
+}
+
+/* the whole graphics plane through single byte ^A writes */
+static void
+gen_write(struct stream *s){
+	unsigned i;
+	put_addr(s,LCD_GRAPHIC_BASE);
+	for(i=0;i<2560;i++){
+		stream_put(s,CHAR_WRITE);
+		stream_put(s,pattern(i));
+	}
+}
+
+/* the whole graphics plane, one ^I bulk transfer per row (testlcd.py) */
+static void
+gen_bulk(struct stream *s){
+	unsigned x,y;
+	put_addr(s,LCD_GRAPHIC_BASE);
+	for(y=0;y<64;y++){
+		stream_put(s,CHAR_BULK);
+		stream_put(s,40);
+		for(x=0;x<40;x++)
+			stream_put(s,pattern(40*y+x));
+	}
+}
+
+/* the whole graphics plane in one ^K transfer */
+static void
+gen_lbulk(struct stream *s){
+	unsigned i;
+	put_addr(s,LCD_GRAPHIC_BASE);
+	stream_put(s,CHAR_LBULK);
+	stream_put(s,LCD_GRAPHIC_SIZE & 0xff);
+	stream_put(s,LCD_GRAPHIC_SIZE >> 8);
+	for(i=0;i<LCD_GRAPHIC_SIZE;i++)
+		stream_put(s,pattern(i));
+}
+
+/* a typical dashboard: mostly blank, a frame, two solid bar graphs and
+   a few lines of "text" */
+static uint8_t
+dash(unsigned i){
+	unsigned x = i % 40, y = i / 40;
+	if(y == 0 || y == 63)
+		return 0x3f;
+	if(x == 0)
+		return 0x20;
+	if(x == 39)
+		return 0x01;
+	if(y >= 8 && y < 16 && x >= 2 && x < 30)
+		return 0x3f;
+	if(y >= 20 && y < 28 && x >= 2 && x < 12)
+		return 0x3f;
+	if(y >= 40 && y < 47 && x >= 2 && x < 20)
+		return (i*13) & 0x3f;
+	return 0;
+}
+
+/* packed format encoder, same as pack() in everavr.py */
+static void
+pack_flush(struct stream *s,const uint8_t *lit,unsigned *nlit){
+	unsigned k;
+	if(!*nlit)
+		return;
+	stream_put(s,*nlit);
+	for(k=0;k<*nlit;k++)
+		stream_put(s,lit[k]);
+	*nlit = 0;
+}
+
+static void
+pack_put(struct stream *s,uint8_t (*byte)(unsigned),unsigned len){
+	uint8_t lit[0x7f];
+	unsigned i = 0, nlit = 0, n, k;
+	uint8_t b;
+
+	while(i < len){
+		b = byte(i);
+		for(n=1;i+n < len && byte(i+n) == b;n++)
+			;
+		i += n;
+		if(n < 3){
+			while(n--){
+				lit[nlit++] = b;
+				if(nlit == sizeof(lit))
+					pack_flush(s,lit,&nlit);
+			}
+			continue;
+		}
+		pack_flush(s,lit,&nlit);
+		while(n){
+			if(b == 0){
+				k = n > 0x4000 ? 0x4000 : n;
+				stream_put(s,PACK_ZERO | ((k-1) >> 8));
+				stream_put(s,(k-1) & 0xff);
+			} else if(n == 1){
+				k = 1;
+				lit[nlit++] = b;
+			} else {
+				k = n > 0x41 ? 0x41 : n;
+				stream_put(s,PACK_REPEAT | (k-2));
+				stream_put(s,b);
+			}
+			n -= k;
+		}
+	}
+	pack_flush(s,lit,&nlit);
+	stream_put(s,PACK_END);
+}
+
+/* the dashboard raw with ^K ... */
+static void
+gen_dash_raw(struct stream *s){
+	unsigned i;
+	put_addr(s,LCD_GRAPHIC_BASE);
+	stream_put(s,CHAR_LBULK);
+	stream_put(s,LCD_GRAPHIC_SIZE & 0xff);
+	stream_put(s,LCD_GRAPHIC_SIZE >> 8);
+	for(i=0;i<LCD_GRAPHIC_SIZE;i++)
+		stream_put(s,dash(i));
+}
+
+/* ... and packed with ^L */
+static void
+gen_dash_packed(struct stream *s){
+	put_addr(s,LCD_GRAPHIC_BASE);
+	stream_put(s,CHAR_PACKED);
+	pack_put(s,dash,LCD_GRAPHIC_SIZE);
+}
+
+static int
+check_dash(const uint8_t *ram){
+	unsigned i;
+	for(i=0;i<LCD_GRAPHIC_SIZE;i++)
+		if(ram[LCD_GRAPHIC_BASE+i] != dash(i))
+			return 1;
+	return 0;
+}
+
+static int
+check_gfx(const uint8_t *ram){
+	unsigned i;
+	for(i=0;i<2560;i++)
+		if(ram[LCD_GRAPHIC_BASE+i] != pattern(i))
+			return 1;
+	return 0;
+}
+
+/* scattered updates: address set plus one byte, e.g. a changing digit */
+static void
+gen_addr(struct stream *s){
+	unsigned i;
+	for(i=0;i<512;i++){
+		put_addr(s,LCD_GRAPHIC_BASE + (i*97)%2560);
+		stream_put(s,CHAR_WRITE);
+		stream_put(s,0x3f);
+	}
+}
+
+/* ^K of the graphics plane, then ^R of all of it: resync after a glitch */
+static void
+gen_readback(struct stream *s){
+	gen_lbulk(s);
+	stream_put(s,CHAR_READ);
+	stream_put(s,LCD_GRAPHIC_BASE & 0xff);
+	stream_put(s,LCD_GRAPHIC_BASE >> 8);
+	stream_put(s,LCD_GRAPHIC_SIZE & 0xff);
+	stream_put(s,LCD_GRAPHIC_SIZE >> 8);
+}
+
+/* the answer: the graphics plane as gen_lbulk() wrote it */
+static int
+check_readback(const uint8_t *rb,size_t len){
+	unsigned i;
+	if(len != LCD_GRAPHIC_SIZE)
+		return 1;
+	for(i=0;i<LCD_GRAPHIC_SIZE;i++)
+		if(rb[i] != pattern(i))
+			return 1;
+	return 0;
+}
+
+/* what ^N and ^V scenarios should leave in the graphics plane, drawn
+   pixel by pixel */
+static uint8_t ref_px[LCD_HEIGHT][LCD_WIDTH];
+
+static void
+ref_pixel(unsigned x,unsigned y,uint8_t mode){
+	if(x >= LCD_WIDTH || y >= LCD_HEIGHT)
+		return;
+	if(mode == DRAW_XOR)
+		ref_px[y][x] ^= 1;
+	else
+		ref_px[y][x] = mode == DRAW_SET;
+}
+
+static int
+check_ref(const uint8_t *ram){
+	unsigned x,y;
+	for(y=0;y<LCD_HEIGHT;y++)
+		for(x=0;x<LCD_WIDTH;x++)
+			if(((ram[LCD_GRAPHIC_BASE + y*LCD_GRAPHIC_COLS + x/6]
+			    >> (5 - x%6)) & 1) != ref_px[y][x])
+				return 1;
+	return 0;
+}
+
+/* ^N labels: plain, bold, opaque inverted, and one XOR'ed twice, which
+   must vanish */
+
+static void
+put_label(struct stream *s,uint8_t x,uint8_t y,uint8_t flags,
+		const char *str){
+	const uint16_t *offs = flags & TEXT_FONT(1) ? font8b_offs : font8_offs;
+	const uint8_t *cols = flags & TEXT_FONT(1) ? font8b_cols : font8_cols;
+	uint8_t mode = flags & DRAW_MODE;
+	unsigned i, k, r, px = x, c, w;
+
+	stream_put(s,CHAR_TEXT);
+	stream_put(s,x);
+	stream_put(s,y);
+	stream_put(s,flags);
+	stream_put(s,strlen(str));
+	for(i=0;str[i];i++){
+		stream_put(s,str[i]);
+		c = str[i] - FONT8_FIRST;
+		w = offs[c+1] - offs[c];
+		for(k=0;k < w + FONT8_SPACING;k++,px++)
+			for(r=0;r < FONT8_HEIGHT;r++){
+				int on = k < w && (cols[offs[c]+k] >> r) & 1;
+				if(mode == DRAW_XOR ? on : on || (flags & DRAW_OPAQUE))
+					ref_pixel(px,y+r,
+						mode == DRAW_XOR || on ? mode :
+						mode == DRAW_SET ? DRAW_CLEAR : DRAW_SET);
+			}
+	}
+}
+
+static void
+gen_label(struct stream *s){
+	memset(ref_px,0,sizeof(ref_px));
+	put_label(s,7,3,DRAW_SET,"Temp: 23.5 C");
+	put_label(s,100,20,DRAW_SET|TEXT_FONT(1),"Bold Label");
+	put_label(s,50,50,DRAW_CLEAR|DRAW_OPAQUE,"Inverted {gjpqy}");
+	put_label(s,13,40,DRAW_XOR,"xor twice");
+	put_label(s,13,40,DRAW_XOR,"xor twice");
+	put_label(s,200,60,DRAW_SET,"clipped");
+}
+
+/* ^V primitives, a small chart: frame, bars, a polyline, markers;
+   some of it XOR'ed, cleared and clipped */
+static void
+put_draw(struct stream *s,uint8_t op,int x0,int y0,int x1,int y1){
+	int i, t, dx, dy, sx, sy, err, e2;
+	uint8_t mode = op & DRAW_MODE, a[4] = { x0, y0, x1, y1 };
+
+	stream_put(s,CHAR_DRAW);
+	stream_put(s,op);
+	switch(op & DRAW_OP){
+	case DRAW_HLINE: /* x0 x1 y */
+		a[1] = x1;
+		a[2] = y0;
+		break;
+	case DRAW_VLINE: /* x y0 y1 */
+		a[2] = y1;
+		break;
+	}
+	for(i=0;i<DRAW_NARGS(op & DRAW_OP);i++)
+		stream_put(s,a[i]);
+
+	if(x0 > x1 && (op & DRAW_OP) != DRAW_LINE){
+		t = x0; x0 = x1; x1 = t;
+	}
+	if(y0 > y1 && (op & DRAW_OP) != DRAW_LINE){
+		t = y0; y0 = y1; y1 = t;
+	}
+	switch(op & DRAW_OP){
+	case DRAW_PLOT:
+		ref_pixel(x0,y0,mode);
+		break;
+	case DRAW_HLINE:
+		for(i=x0;i<=x1;i++)
+			ref_pixel(i,y0,mode);
+		break;
+	case DRAW_VLINE:
+		for(i=y0;i<=y1;i++)
+			ref_pixel(x0,i,mode);
+		break;
+	case DRAW_LINE:
+		dx = abs(x1-x0);
+		dy = -abs(y1-y0);
+		sx = x0 < x1 ? 1 : -1;
+		sy = y0 < y1 ? 1 : -1;
+		err = dx + dy;
+		for(;;){
+			ref_pixel(x0,y0,mode);
+			if(x0 == x1 && y0 == y1)
+				break;
+			e2 = 2*err;
+			if(e2 >= dy){ err += dy; x0 += sx; }
+			if(e2 <= dx){ err += dx; y0 += sy; }
+		}
+		break;
+	case DRAW_RECT:
+		for(i=x0;i<=x1;i++){
+			ref_pixel(i,y0,mode);
+			if(y1 != y0)
+				ref_pixel(i,y1,mode);
+		}
+		for(i=y0+1;i<y1;i++){
+			ref_pixel(x0,i,mode);
+			if(x1 != x0)
+				ref_pixel(x1,i,mode);
+		}
+		break;
+	case DRAW_FILL:
+		for(t=y0;t<=y1;t++)
+			for(i=x0;i<=x1;i++)
+				ref_pixel(i,t,mode);
+		break;
+	}
+}
+
+static void
+gen_draw(struct stream *s){
+	static const uint8_t curve[] = { 50, 42, 45, 30, 33, 20, 26, 12, 18,
+		25, 15, 40, 38, 55, 47, 52, 58, 44, 36, 30, 22 };
+	unsigned i;
+
+	memset(ref_px,0,sizeof(ref_px));
+	put_draw(s,DRAW_RECT|DRAW_SET,0,0,239,63);
+	for(i=0;i<6;i++)
+		put_draw(s,DRAW_FILL|DRAW_SET,5+i*9,60-i*8,11+i*9,60);
+	put_draw(s,DRAW_FILL|DRAW_CLEAR,7,45,50,50);
+	put_draw(s,DRAW_FILL|DRAW_XOR,3,3,30,10);
+	for(i=0;i+1<sizeof(curve);i++)
+		put_draw(s,DRAW_LINE|DRAW_SET,70+i*8,curve[i],78+i*8,curve[i+1]);
+	for(i=0;i<sizeof(curve);i++)
+		put_draw(s,DRAW_PLOT|DRAW_XOR,70+i*8,curve[i],70+i*8,curve[i]);
+	put_draw(s,DRAW_LINE|DRAW_XOR,239,0,60,63);
+	put_draw(s,DRAW_HLINE|DRAW_SET,230,31,70,31);  /* reversed */
+	put_draw(s,DRAW_VLINE|DRAW_CLEAR,100,63,100,2);
+	put_draw(s,DRAW_RECT|DRAW_XOR,200,50,250,70); /* clipped */
+	put_draw(s,DRAW_LINE|DRAW_SET,230,10,255,20);
+	put_draw(s,DRAW_RECT|DRAW_SET,64,5,64,5);
+}
+
+/* four ^O tiles into the upper half of CG RAM, then a row of text
+   codes that shows them with the internal CG */
+static uint8_t
+tile(unsigned i){
+	return (i * 11 + (i >> 3)) & 0x3f;
+}
+
+static void
+gen_tiles(struct stream *s){
+	unsigned i;
+	stream_put(s,CHAR_TILES);
+	stream_put(s,TILE_INT_CG);
+	stream_put(s,4);
+	for(i=0;i<4*TILE_SIZE;i++)
+		stream_put(s,tile(i));
+	put_addr(s,LCD_TEXT_BASE);
+	stream_put(s,CHAR_BULK);
+	stream_put(s,LCD_TEXT_SIZE/8);
+	for(i=0;i<LCD_TEXT_SIZE/8;i++)
+		stream_put(s,TILE_INT_CG + i%4);
+}
+
+static int
+check_tiles(const uint8_t *ram){
+	unsigned i;
+	for(i=0;i<4*TILE_SIZE;i++)
+		if(ram[LCD_CGRAM_BASE + TILE_INT_CG*TILE_SIZE + i] != tile(i))
+			return 1;
+	for(i=0;i<LCD_TEXT_SIZE/8;i++)
+		if(ram[LCD_TEXT_BASE+i] != TILE_INT_CG + i%4)
+			return 1;
+	return 0;
+}
+
+/* ^W: scroll both planes up and down with new lines, draw into the
+   scrolled graphics plane, scroll some more (the drawing has to move
+   along), then SCROLL_OFF; what's left in the normal planes is
+   compared with scroll_ram, the same done with memmove() */
+static uint8_t scroll_ram[LCD_CGRAM_BASE];
+
+static void
+put_scroll(struct stream *s,uint8_t op,unsigned k){
+	uint16_t base = op & SCROLL_GRAPHICS ? LCD_GRAPHIC_BASE : LCD_TEXT_BASE;
+	unsigned n = op & SCROLL_GRAPHICS ? LCD_HEIGHT : LCD_TEXT_LINES, i;
+	uint8_t *plane = scroll_ram + base, *line;
+
+	stream_put(s,CHAR_SCROLL);
+	stream_put(s,op | SCROLL_DATA);
+	if(op & SCROLL_DOWN){
+		memmove(plane + 40,plane,(n-1)*40);
+		line = plane;
+	} else {
+		memmove(plane,plane + 40,(n-1)*40);
+		line = plane + (n-1)*40;
+	}
+	for(i=0;i<40;i++){
+		line[i] = (k*5 + i) & 0x3f;
+		stream_put(s,line[i]);
+	}
+}
+
+static void
+gen_scroll(struct stream *s){
+	unsigned i;
+
+	memset(scroll_ram,0,sizeof(scroll_ram));
+	gen_lbulk(s);
+	for(i=0;i<LCD_GRAPHIC_SIZE;i++)
+		scroll_ram[LCD_GRAPHIC_BASE+i] = pattern(i);
+	gen_text(s);
+	for(i=0;i<320;i++)
+		scroll_ram[LCD_TEXT_BASE+i] = i%95;
+
+	for(i=0;i<100;i++)
+		put_scroll(s,SCROLL_GRAPHICS|SCROLL_UP,i);
+	for(i=0;i<70;i++)
+		put_scroll(s,SCROLL_GRAPHICS|SCROLL_DOWN,i+100);
+	/* whole bytes, 1..5 of lines 10..12 */
+	stream_put(s,CHAR_DRAW);
+	stream_put(s,DRAW_FILL|DRAW_SET);
+	stream_put(s,6);
+	stream_put(s,10);
+	stream_put(s,35);
+	stream_put(s,12);
+	for(i=10;i<=12;i++)
+		memset(scroll_ram + LCD_GRAPHIC_BASE + i*40 + 1,0x3f,5);
+	for(i=0;i<5;i++)
+		put_scroll(s,SCROLL_GRAPHICS|SCROLL_UP,i+200);
+	stream_put(s,CHAR_SCROLL);
+	stream_put(s,SCROLL_GRAPHICS|SCROLL_OFF);
+
+	for(i=0;i<20;i++)
+		put_scroll(s,SCROLL_UP,i);
+	for(i=0;i<11;i++)
+		put_scroll(s,SCROLL_DOWN,i+20);
+	stream_put(s,CHAR_SCROLL);
+	stream_put(s,SCROLL_OFF);
+}
+
+static int
+check_scroll(const uint8_t *ram){
+	return memcmp(ram,scroll_ram,LCD_TEXT_SIZE+LCD_GRAPHIC_SIZE) != 0;
+}
+
+/* ^X: frame into the hidden page through the usual ^C + ^K, flip with
+   copy, a bar into the (new) hidden page 0, text on page 1, flip back */
+static void
+gen_flip(struct stream *s){
+	stream_put(s,CHAR_PAGE);
+	stream_put(s,PAGE_BACK|PAGE_TEXT);
+	gen_lbulk(s);
+	gen_text(s);
+	stream_put(s,CHAR_PAGE);
+	stream_put(s,PAGE_FLIP|PAGE_COPY|PAGE_BACK);
+	stream_put(s,CHAR_DRAW);
+	stream_put(s,DRAW_FILL|DRAW_SET);
+	stream_put(s,6);
+	stream_put(s,10);
+	stream_put(s,35);
+	stream_put(s,12);
+	stream_put(s,CHAR_PAGE);
+	stream_put(s,PAGE_FLIP);
+}
+
+static int
+check_flip(const uint8_t *ram){
+	unsigned i, y, x;
+	for(i=0;i<320;i++)
+		if(ram[LCD_TEXT_BASE+i] != 0 || ram[LCD_TEXT_PAGE1+i] != i%95)
+			return 1;
+	for(i=0;i<LCD_GRAPHIC_SIZE;i++){
+		y = i / 40;
+		x = i % 40;
+		if(ram[LCD_GRAPHIC_PAGE1+i] != pattern(i))
+			return 1;
+		if(ram[LCD_GRAPHIC_BASE+i] != (y >= 10 && y <= 12 &&
+		   x >= 1 && x <= 5 ? 0x3f : pattern(i)))
+			return 1;
+	}
+	return 0;
+}
+
+/* ^X on a fresh page 1: 60 of the 64 graphics lines and 6 of the 8
+   text lines (testlcd.py), flipped without PAGE_COPY; the rest of the
+   page must be blank, not RAM left over from power up */
+#define FLIP_LINES 60
+#define FLIP_CHARS (6*LCD_TEXT_COLS)
+
+static void
+gen_flip_part(struct stream *s){
+	unsigned i;
+
+	stream_put(s,CHAR_PAGE);
+	stream_put(s,PAGE_BACK|PAGE_TEXT);
+	put_addr(s,LCD_GRAPHIC_BASE);
+	stream_put(s,CHAR_LBULK);
+	stream_put(s,(FLIP_LINES*40) & 0xff);
+	stream_put(s,(FLIP_LINES*40) >> 8);
+	for(i=0;i<FLIP_LINES*40;i++)
+		stream_put(s,pattern(i));
+	put_addr(s,LCD_TEXT_BASE);
+	for(i=0;i<FLIP_CHARS;i++)
+		stream_put(s,0x20 + i%95);
+	stream_put(s,CHAR_PAGE);
+	stream_put(s,PAGE_FLIP|PAGE_TEXT);
+}
+
+static int
+check_flip_part(const uint8_t *ram){
+	unsigned i;
+	for(i=0;i<LCD_TEXT_SIZE;i++)
+		if(ram[LCD_TEXT_PAGE1+i] != (i < FLIP_CHARS ? i%95 : 0))
+			return 1;
+	for(i=0;i<LCD_GRAPHIC_SIZE;i++)
+		if(ram[LCD_GRAPHIC_PAGE1+i] !=
+		   (i < FLIP_LINES*40 ? pattern(i) : 0))
+			return 1;
+	return 0;
+}
+
+/* ^Y: a log scrolling through the terminal, a line that wraps, then
+   some escapes: inverse text on top, erase to the end, from the start
+   and the whole line, a tab; after ^Y the text stays where it was on
+   screen and the graphics plane (attributes) is clear */
+static void
+put_str(struct stream *s,const char *p){
+	while(*p)
+		stream_put(s,*p++);
+}
+
+static void
+gen_term(struct stream *s){
+	char line[16];
+	unsigned i;
+
+	stream_put(s,CHAR_TERMINAL);
+	for(i=0;i<20;i++){
+		snprintf(line,sizeof(line),"line %u\r\n",i);
+		put_str(s,line);
+	}
+	for(i=0;i<4;i++)
+		put_str(s,"0123456789");
+	put_str(s,"abcde");
+	put_str(s,"\033[1;1H\033[7mTOP\033[0m");
+	put_str(s,"\033[3;4H\033[K");
+	put_str(s,"\033[8;3H\033[1K\tX");
+	put_str(s,"\033[5;1H\033[2K");
+	stream_put(s,CHAR_TERMINAL);
+}
+
+static int
+check_term(const uint8_t *ram){
+	static const char *want[LCD_TEXT_LINES] = {
+		"TOPe 14", "line 15", "lin", "line 17", "", "line 19",
+		"0123456789012345678901234567890123456789", "   de   X"
+	};
+	unsigned i, y, x;
+	uint8_t c;
+
+	for(y=0;y<LCD_TEXT_LINES;y++)
+		for(x=0;x<LCD_TEXT_COLS;x++){
+			c = x < strlen(want[y]) ? want[y][x] - 0x20 : 0;
+			if(ram[LCD_TEXT_BASE + y*LCD_TEXT_COLS + x] != c)
+				return 1;
+		}
+	for(i=0;i<LCD_GRAPHIC_SIZE;i++)
+		if(ram[LCD_GRAPHIC_BASE+i])
+			return 1;
+	return 0;
+}
+
+/* ^Y: tail -f of a log, lines of 39 chars; the screen shows the last 7
+   and the empty line the cursor is on */
+#define TAIL_LINES 200
+
+static void
+tail_line(char *line,unsigned i){
+	snprintf(line,LCD_TEXT_COLS,"log line %03u: the quick brown fox jumps",
+		i);
+}
+
+static void
+gen_tail(struct stream *s){
+	char line[LCD_TEXT_COLS];
+	unsigned i;
+
+	stream_put(s,CHAR_TERMINAL);
+	for(i=0;i<TAIL_LINES;i++){
+		tail_line(line,i);
+		put_str(s,line);
+		stream_put(s,'\n');
+	}
+	stream_put(s,CHAR_TERMINAL);
+}
+
+static int
+check_tail(const uint8_t *ram){
+	char line[LCD_TEXT_COLS];
+	unsigned y, x;
+	uint8_t c;
+
+	for(y=0;y<LCD_TEXT_LINES;y++){
+		line[0] = 0;
+		if(y < LCD_TEXT_LINES - 1)
+			tail_line(line,TAIL_LINES - (LCD_TEXT_LINES - 1) + y);
+		for(x=0;x<LCD_TEXT_COLS;x++){
+			c = x < strlen(line) ? line[x] - 0x20 : 0;
+			if(ram[LCD_TEXT_BASE + y*LCD_TEXT_COLS + x] != c)
+				return 1;
+		}
+	}
+	return 0;
+}
+
+/* ^E: controller re-initialisation */
+static void
+gen_reset(struct stream *s){
+	stream_put(s,CHAR_RESET);
+}
+
+const struct scenario scenarios[] = {
+	{ "text",  gen_text,  check_text },
+	{ "high",  gen_high,  check_high },
+	{ "write", gen_write, check_gfx },
+	{ "bulk",  gen_bulk,  check_gfx },
+	{ "lbulk", gen_lbulk, check_gfx },
+	{ "dash",  gen_dash_raw,    check_dash },
+	{ "dash_packed", gen_dash_packed, check_dash },
+	{ "addr",  gen_addr,  NULL },
+	{ "readback", gen_readback, check_gfx, check_readback },
+	{ "label", gen_label, check_ref },
+	{ "draw",  gen_draw,  check_ref },
+	{ "tiles", gen_tiles, check_tiles },
+	{ "scroll", gen_scroll, check_scroll },
+	{ "flip",  gen_flip,  check_flip },
+	{ "flip_part", gen_flip_part, check_flip_part },
+	{ "term",  gen_term,  check_term },
+	{ "tail",  gen_tail,  check_tail },
+	{ "reset", gen_reset, NULL },
+};
+
+const unsigned nscenarios = sizeof(scenarios)/sizeof(scenarios[0]);
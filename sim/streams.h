@@ -0,0 +1,28 @@
+#ifndef STREAMS_H
+#define STREAMS_H
+
+/* protocol byte streams for the benches, with checks of the display RAM
+   contents they should leave behind */
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct stream {
+	uint8_t *buf;
+	size_t   len, size;
+};
+
+extern void stream_put(struct stream *s,uint8_t c);
+
+struct scenario {
+	const char *name;
+	void (*gen)(struct stream *s);
+	int (*check)(const uint8_t *ram); /* 0 if ram looks right */
+	/* the bytes ^R sent back, serial or USB, 0 if they're right */
+	int (*check_rb)(const uint8_t *rb,size_t len);
+};
+
+extern const struct scenario scenarios[];
+extern const unsigned nscenarios;
+
+#endif
@@ -0,0 +1,182 @@
+#include "t6963c.h"
+#include "lcd_hardware.h"
+
+#include <string.h>
+
+#define ADP_MASK (T6963C_RAM_SIZE-1)
+
+void
+t6963c_reset(struct t6963c *t,uint8_t power_up){
+	uint32_t i, x = 0x2545f491;
+	if(power_up) /* a fixed xorshift noise, never all zero */
+		for(i=0;i<sizeof(t->ram);i++){
+			x ^= x << 13;
+			x ^= x >> 17;
+			x ^= x << 5;
+			t->ram[i] = x;
+		}
+	t->nparam = 0;
+	t->latch = 0;
+	t->autom = t6963c_auto_off;
+	t->adp = 0;
+	t->offset = 0;
+	t->cursor_x = t->cursor_y = 0;
+	t->text_home = t->text_area = 0;
+	t->gfx_home = t->gfx_area = 0;
+	t->mode = t->display = t->cursor_lines = 0;
+	t->busy_until = 0;
+	if(!t->busy_cmd_ns)
+		t->busy_cmd_ns = T6963C_BUSY_CMD_NS;
+	if(!t->busy_data_ns)
+		t->busy_data_ns = T6963C_BUSY_DATA_NS;
+	if(!t->busy_auto_ns)
+		t->busy_auto_ns = T6963C_BUSY_AUTO_NS;
+	memset(&t->stats,0,sizeof(t->stats));
+}
+
+/* controller accepted something at time now, stays busy for ns */
+static void
+t6963c_busy(struct t6963c *t,uint64_t now,uint32_t ns){
+	if(now < t->busy_until)
+		t->stats.violations++;
+	t->busy_until = now + ns;
+	t->stats.busy_ns += ns;
+}
+
+static void
+t6963c_command(struct t6963c *t,uint8_t cmd){
+	uint16_t p16 = t->param[0] | (t->param[1] << 8);
+
+	switch(cmd & 0xf0){
+	case 0x20:
+		if(cmd == CMD_CURSOR_POS){
+			t->cursor_x = t->param[0];
+			t->cursor_y = t->param[1];
+		} else if(cmd == CMD_OFFSET_REGISTER)
+			t->offset = t->param[0] & 0x1f;
+		else if(cmd == CMD_ADDRESS_POINTER)
+			t->adp = p16 & ADP_MASK;
+		break;
+	case 0x40:
+		if(cmd == CMD_TEXT_HOME_ADDR)
+			t->text_home = p16;
+		else if(cmd == CMD_TEXT_AREA)
+			t->text_area = t->param[0];
+		else if(cmd == CMD_GRAPHIC_HOME_ADDR)
+			t->gfx_home = p16;
+		else if(cmd == CMD_GRAPHIC_AREA)
+			t->gfx_area = t->param[0];
+		break;
+	case 0x80:
+		t->mode = cmd & 0x0f;
+		break;
+	case 0x90:
+		t->display = cmd & 0x0f;
+		break;
+	case 0xa0:
+		t->cursor_lines = (cmd & 0x07) + 1;
+		break;
+	case 0xb0:
+		if(cmd == CMD_AUTO_WRITE)
+			t->autom = t6963c_auto_write;
+		else if(cmd == CMD_AUTO_READ)
+			t->autom = t6963c_auto_read;
+		else if(cmd == CMD_AUTO_RESET)
+			t->autom = t6963c_auto_off;
+		break;
+	case 0xc0:
+		switch(cmd){
+		case CMD_DATA_WRITE_INC:
+			t->ram[t->adp] = t->param[0];
+			t->adp = (t->adp+1) & ADP_MASK;
+			break;
+		case CMD_DATA_READ_INC:
+			t->latch = t->ram[t->adp];
+			t->adp = (t->adp+1) & ADP_MASK;
+			break;
+		case CMD_DATA_WRITE_DEC:
+			t->ram[t->adp] = t->param[0];
+			t->adp = (t->adp-1) & ADP_MASK;
+			break;
+		case CMD_DATA_READ_DEC:
+			t->latch = t->ram[t->adp];
+			t->adp = (t->adp-1) & ADP_MASK;
+			break;
+		case CMD_DATA_WRITE:
+			t->ram[t->adp] = t->param[0];
+			break;
+		case CMD_DATA_READ:
+			t->latch = t->ram[t->adp];
+			break;
+		}
+		break;
+	case 0xf0: /* bit set (0xf8..0xff) / reset (0xf0..0xf7) */
+		if(cmd & 0x08)
+			t->ram[t->adp] |=  (1 << (cmd & 0x07));
+		else
+			t->ram[t->adp] &= ~(1 << (cmd & 0x07));
+		break;
+	default: /* screen peek/copy and undefined commands are ignored */
+		break;
+	}
+	t->nparam = 0;
+}
+
+void
+t6963c_write(struct t6963c *t,uint8_t cd,uint8_t data,uint64_t now){
+	if(cd){
+		t->stats.cmd_writes++;
+		t6963c_command(t,data);
+		t6963c_busy(t,now,t->busy_cmd_ns);
+		return;
+	}
+
+	t->stats.data_writes++;
+	if(t->autom == t6963c_auto_write){
+		t->ram[t->adp] = data;
+		t->adp = (t->adp+1) & ADP_MASK;
+		t6963c_busy(t,now,t->busy_auto_ns);
+		return;
+	}
+
+	/* parameter for the next command, the controller keeps the last two */
+	if(t->nparam == 2){
+		t->param[0] = t->param[1];
+		t->nparam = 1;
+	}
+	t->param[t->nparam++] = data;
+	t6963c_busy(t,now,t->busy_data_ns);
+}
+
+uint8_t
+t6963c_read(struct t6963c *t,uint8_t cd,uint64_t now){
+	uint8_t ret;
+
+	if(cd){
+		t->stats.status_reads++;
+		if(now < t->busy_until){
+			t->stats.busy_polls++;
+			return 0;
+		}
+		/* STA0/STA1 are documented as invalid in auto mode; the
+		   real controller reports them as set, so do we. */
+		ret = STATUS_CMD_OK | STATUS_DATA_OK | STATUS_OPERATION;
+		if(t->autom == t6963c_auto_write)
+			ret |= STATUS_AUTO_WRITE_OK;
+		else if(t->autom == t6963c_auto_read)
+			ret |= STATUS_AUTO_READ_OK;
+		return ret;
+	}
+
+	t->stats.data_reads++;
+	if(now < t->busy_until)
+		t->stats.violations++;
+	if(t->autom == t6963c_auto_read){
+		ret = t->ram[t->adp];
+		t->adp = (t->adp+1) & ADP_MASK;
+		t->busy_until = now + t->busy_auto_ns;
+		t->stats.busy_ns += t->busy_auto_ns;
+		return ret;
+	}
+	return t->latch;
+}
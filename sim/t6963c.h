@@ -0,0 +1,67 @@
+#ifndef T6963C_H
+#define T6963C_H
+
+/* software model of the Toshiba T6963C LCD controller, as used on the
+   Everbouquet MG24065G. It only knows about the parallel bus (C/\D,
+   \RD, \WR and D0..D7), the status register, the command set and the
+   external display RAM; nothing is ever actually displayed. */
+
+#include <stdint.h>
+
+#define T6963C_RAM_SIZE		0x2000
+
+/* default time (ns) the controller stays busy after accepting a
+   command, a data byte in normal mode or a data byte in auto mode */
+#define T6963C_BUSY_CMD_NS	1200
+#define T6963C_BUSY_DATA_NS	600
+#define T6963C_BUSY_AUTO_NS	400
+
+enum t6963c_auto {
+	t6963c_auto_off,
+	t6963c_auto_write,
+	t6963c_auto_read
+};
+
+struct t6963c_stats {
+	unsigned long cmd_writes;   /* bytes written to the command reg. */
+	unsigned long data_writes;  /* bytes written to the data reg. */
+	unsigned long status_reads; /* status register reads */
+	unsigned long busy_polls;   /* ... of which found the ctrl. busy */
+	unsigned long data_reads;   /* bytes read from the data reg. */
+	unsigned long violations;   /* bus accesses while ctrl. was busy */
+	uint64_t      busy_ns;      /* sum of all modelled busy periods */
+};
+
+struct t6963c {
+	uint8_t  ram[T6963C_RAM_SIZE];
+
+	uint8_t  param[2];      /* data bytes written before a command */
+	uint8_t  nparam;
+	uint8_t  latch;         /* data register, read side */
+	uint8_t  autom;         /* enum t6963c_auto */
+
+	uint16_t adp;           /* address pointer */
+	uint16_t offset;        /* ext. CG RAM offset register */
+	uint8_t  cursor_x, cursor_y;
+	uint16_t text_home, text_area;
+	uint16_t gfx_home, gfx_area;
+	uint8_t  mode, display, cursor_lines;
+
+	uint64_t busy_until;    /* ns timestamp, controller ready after */
+	uint32_t busy_cmd_ns, busy_data_ns, busy_auto_ns;
+
+	struct t6963c_stats stats;
+};
+
+/* reset: clear registers, statistics and RAM contents are kept unless
+   power_up is set, then RAM holds noise as on a panel just switched on */
+extern void t6963c_reset(struct t6963c *t,uint8_t power_up);
+
+/* bus write cycle (\WR rising edge) at time now (ns), cd=1 command */
+extern void t6963c_write(struct t6963c *t,uint8_t cd,uint8_t data,
+	uint64_t now);
+
+/* bus read cycle (\RD low) at time now (ns), cd=1 status register */
+extern uint8_t t6963c_read(struct t6963c *t,uint8_t cd,uint64_t now);
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef SIM_USBDRV_H
+#define SIM_USBDRV_H
+
+/* just enough of V-USB's usbdrv.h to compile everavr.c on the host, the
+   USB side is driven directly by the bench (see sim/bench.c) */
+
+#include <stdint.h>
+#include <avr/pgmspace.h>
+#include "usbconfig.h"
+
+typedef unsigned char uchar;
+#if USB_CFG_LONG_TRANSFERS
+typedef uint16_t usbMsgLen_t;
+#else
+typedef uint8_t usbMsgLen_t;
+#endif
+
+typedef union usbWord {
+	uint16_t word;
+	uchar    bytes[2];
+} usbWord_t;
+
+typedef struct usbRequest {
+	uchar     bmRequestType;
+	uchar     bRequest;
+	usbWord_t wValue;
+	usbWord_t wIndex;
+	usbWord_t wLength;
+} usbRequest_t;
+
+#define USB_NO_MSG		((usbMsgLen_t)-1)
+
+#define USBRQ_TYPE_MASK		0x60
+#define USBRQ_TYPE_STANDARD	(0<<5)
+#define USBRQ_TYPE_CLASS	(1<<5)
+#define USBRQ_TYPE_VENDOR	(2<<5)
+
+#define USBRQ_HID_GET_REPORT	0x01
+#define USBRQ_HID_SET_REPORT	0x09
+
+/* USB_CFG_HAVE_FLOWCONTROL, the bench waits while it's set */
+static uchar sim_usb_stopped;
+#define usbDisableAllRequests()     (sim_usb_stopped = 1)
+#define usbEnableAllRequests()      (sim_usb_stopped = 0)
+#define usbAllRequestsAreDisabled() (sim_usb_stopped)
+
+static inline void usbInit(void){ }
+static inline void usbPoll(void){ }
+static inline void usbDeviceConnect(void){ }
+static inline void usbDeviceDisconnect(void){ }
+
+#endif
@@ -0,0 +1,6 @@
+/* boot screen, 2880 bytes packed to 16, generated by
+   mksplash.py 'Hello World!' */
+PROGMEM const uint8_t splash[16] = {
+	0x0c, 0x28, 0x45, 0x4c, 0x4c, 0x4f, 0x00, 0x37, 0x4f, 0x52, 0x4c, 0x44,
+	0x01, 0xcb, 0x33, 0x00,
+};
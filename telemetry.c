@@ -0,0 +1,42 @@
+#include "telemetry.h"
+
+#if TELEMETRY
+
+#include <avr/io.h>
+#include <string.h>
+
+struct telemetry tm;
+static uint16_t tm_last;
+
+void
+tm_clear(){
+	memset(&tm,0,sizeof(tm));
+	tm.version = TM_VERSION;
+	tm.size = sizeof(tm);
+	tm.tick_ns = TM_TICK_NS;
+	tm_last = TCNT1;
+}
+
+void
+tm_halve(uint16_t *h,uint8_t b){
+	uint8_t i;
+	for(i=0;i<TM_BUCKETS;i++)
+		h[i] >>= 1;
+	h[b] = 0x8000;
+}
+
+void
+tm_init(){
+	tm_clear();
+}
+
+void
+tm_loop(){
+	uint16_t t = TCNT1, d = t - tm_last;
+	tm_last = t;
+	tm_hist(tm.loop,tm_bucket(d));
+	if(d > tm.loop_max)
+		tm.loop_max = d;
+}
+
+#endif
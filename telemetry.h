@@ -0,0 +1,105 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+/* Counters and small histograms about what the firmware has been
+   doing, dumped with ^T (see protocol.h). Layout of struct telemetry is
+   the wire format, little endian, mirrored in everavr.py; bump
+   TM_VERSION when it changes. Build with -DTELEMETRY=0 to compile all
+   of it out of the LCD inner loops. */
+
+#include <stdint.h>
+
+#ifndef TELEMETRY
+#define TELEMETRY 1
+#endif
+
+#define TM_VERSION	3
+
+#define TM_BUCKETS	8	/* 1, 2-3, 4-7, .. 64-127, >= 128 */
+
+/* The histograms are 16 bit to save SRAM (the ATmega168 has 1 KB for
+   everything): a bucket that would overflow halves its whole histogram
+   instead, so they keep the shape of the distribution, not the counts. */
+
+/* status polls, by what was waited for */
+#define TM_POLL_CMD	0	/* STA0/STA1: lcd_command(), lcd_data() */
+#define TM_POLL_AUTO_WR	1	/* STA3: lcd_auto_write() */
+#define TM_POLL_AUTO_RD	2	/* STA2: lcd_auto_read(), lcd_auto_reset() */
+#define TM_NPOLL	3
+
+/* Timer1 runs free at F_CPU/256 (io_init() in everavr.c), main loop
+   times are in these ticks */
+#define TM_TICK_NS	(256000000000ULL/F_CPU)
+
+struct telemetry {
+	uint8_t  version;		/* TM_VERSION */
+	uint8_t  size;			/* sizeof(struct telemetry) */
+	uint16_t tick_ns;		/* TM_TICK_NS */
+	uint32_t rx_uart;		/* bytes queued from the UART */
+	uint32_t rx_usb;		/* bytes queued from USB */
+	uint32_t tx;			/* bytes queued for the UART */
+	uint32_t printable;		/* text chars eaten */
+	uint16_t poll[TM_NPOLL][TM_BUCKETS]; /* polls until ok */
+	uint16_t loop[TM_BUCKETS];	/* main loop iterations, ticks */
+	uint16_t uart_lost;		/* RX bytes dropped, input buffer full */
+	uint16_t uart_overrun;		/* USART data overruns (DOR0) */
+	uint16_t tx_lost;		/* TX bytes dropped, output buffer full */
+	uint16_t loop_max;		/* longest iteration, ticks */
+	uint16_t poll_timeout[TM_NPOLL];
+	uint16_t readback_cancel;	/* USB readbacks not fetched */
+	uint16_t uart_stops;		/* RTS raised */
+	uint16_t usb_stops;		/* USB requests disabled */
+	uint16_t cmd[0x20];		/* control chars eaten, by code */
+};
+
+#if TELEMETRY
+
+extern struct telemetry tm;
+
+static inline uint8_t
+tm_bucket(uint16_t n){
+	uint8_t b = 0;
+	while(n > 1 && b < TM_BUCKETS-1){
+		n >>= 1;
+		b++;
+	}
+	return b;
+}
+
+/* bucket b of histogram h overflowed */
+extern void tm_halve(uint16_t *h,uint8_t b);
+
+static inline void
+tm_hist(uint16_t *h,uint8_t b){
+	if(!++h[b])
+		tm_halve(h,b);
+}
+
+/* n polls, 0 = gave up */
+static inline void
+tm_poll(uint8_t which,uint16_t n){
+	if(n)
+		tm_hist(tm.poll[which],tm_bucket(n));
+	else
+		tm.poll_timeout[which]++;
+}
+
+#define tm_count(field,n)	(tm.field += (n))
+
+/* clear everything, once Timer1 runs */
+extern void tm_init();
+extern void tm_clear();
+/* once per main loop iteration */
+extern void tm_loop();
+
+#else
+
+#define tm_poll(which,n)	((void)(n))
+#define tm_count(field,n)	((void)(n))
+#define tm_init()		do { } while(0)
+#define tm_clear()		do { } while(0)
+#define tm_loop()		do { } while(0)
+
+#endif
+
+#endif
@@ -0,0 +1,383 @@
+#include "term.h"
+#include "lcd_hardware.h"
+#include "protocol.h"
+#include "scroll.h"
+#include "page.h"
+
+#define COLS	LCD_TEXT_COLS
+#define LINES	LCD_TEXT_LINES
+#define TAB	8
+#define NPAR	4	/* ESC [ parameters, more are dropped */
+
+#define CHAR_CAN 0x18	/* aborts an escape */
+#define CHAR_SUB 0x1a
+#define CHAR_ESC 0x1b
+
+/* graphics on: it holds the attributes */
+#define TERM_DISP (CMD_DISP_TEXT | CMD_DISP_GRAPHICS)
+#define TERM_CURSOR (CMD_DISP_CURSOR | CMD_DISP_CURSOR_BLINK)
+
+enum term_state {
+	term_text,
+	term_escape,
+	term_params
+};
+
+static uint8_t term_state;
+static uint8_t term_par[NPAR], term_npar, term_private;
+
+static uint8_t term_x, term_y;	/* term_x == COLS: wrap at the next char */
+static uint8_t term_attr;	/* ATTRIB_* of new chars */
+static uint8_t term_save_x, term_save_y, term_save_attr;
+static uint8_t term_disp;	/* CMD_DISP_* */
+static uint8_t term_moved;	/* the hardware cursor is behind */
+
+/* bit per screen line that may have attributes other than ATTRIB_NORMAL;
+   while there are none, the attribute plane isn't written or scrolled */
+static uint8_t term_attr_lines;
+
+/* chars printed on line term_y from column term_span_x on, with
+   term_span_attr, not in display RAM yet; written in one auto write
+   run per copy by term_flush() before anything else moves the cursor
+   or touches the display */
+static uint8_t term_span[COLS];
+static uint8_t term_span_x, term_span_n, term_span_attr;
+
+/* ---------- display RAM, both copies of a scrolling line ---------- */
+
+static void
+term_span_write(uint16_t addr){
+	uint8_t i;
+	lcd_command_long(CMD_ADDRESS_POINTER,addr + term_span_x);
+	lcd_command(CMD_AUTO_WRITE);
+	for(i=0;i<term_span_n;i++)
+		lcd_auto_write(term_span[i]);
+	lcd_auto_reset();
+}
+
+static void
+term_fill(uint8_t plane,uint8_t y,uint8_t x,uint8_t n,uint8_t v){
+	uint16_t twin = scroll_twin(plane,y);
+	lcd_fill(scroll_addr(plane,y) + x,n,v);
+	if(twin)
+		lcd_fill(twin + x,n,v);
+}
+
+static void
+term_flush(){
+	uint16_t twin;
+	if(!term_span_n)
+		return;
+	twin = scroll_twin(SCROLL_TEXT,term_y);
+	term_span_write(scroll_addr(SCROLL_TEXT,term_y));
+	if(twin)
+		term_span_write(twin);
+	if(term_span_attr || (term_attr_lines & _BV(term_y))){
+		term_fill(SCROLL_ATTRIB,term_y,term_span_x,term_span_n,
+			term_span_attr);
+		if(term_span_attr)
+			term_attr_lines |= _BV(term_y);
+	}
+	term_span_n = 0;
+}
+
+/* clear columns x0..x1-1 of line y */
+static void
+term_erase(uint8_t y,uint8_t x0,uint8_t x1){
+	if(x0 >= x1)
+		return;
+	term_fill(SCROLL_TEXT,y,x0,x1 - x0,0);
+	if(!(term_attr_lines & _BV(y)))
+		return;
+	term_fill(SCROLL_ATTRIB,y,x0,x1 - x0,ATTRIB_NORMAL);
+	if(x0 == 0 && x1 == COLS)
+		term_attr_lines &= ~_BV(y);
+}
+
+/* SCROLL_UP or SCROLL_DOWN, the new line is blank */
+static void
+term_scroll(uint8_t op){
+	scroll_plane(SCROLL_TEXT,op,0);
+	if(term_attr_lines)
+		scroll_plane(SCROLL_ATTRIB,op,0);
+	if(op == SCROLL_DOWN)
+		term_attr_lines <<= 1;
+	else
+		term_attr_lines >>= 1;
+}
+
+/* ---------- cursor ---------- */
+
+static void
+term_lf(){
+	if(term_y < LINES - 1)
+		term_y++;
+	else
+		term_scroll(SCROLL_UP);
+}
+
+static void
+term_ri(){
+	if(term_y)
+		term_y--;
+	else
+		term_scroll(SCROLL_DOWN);
+}
+
+static void
+term_print(uint8_t c){
+	if(term_x == COLS){
+		term_flush();
+		term_x = 0;
+		term_lf();
+	}
+	if(!term_span_n){
+		term_span_x = term_x;
+		term_span_attr = term_attr;
+	}
+	term_span[term_span_n++] = c - 0x20; /* as in eat_char() */
+	term_x++;
+}
+
+static void
+term_clear(){
+	uint8_t y;
+	for(y=0;y<LINES;y++)
+		term_erase(y,0,COLS);
+	term_x = term_y = 0;
+	term_attr = ATTRIB_NORMAL;
+}
+
+/* ---------- escapes ---------- */
+
+static void
+term_sgr(){
+	uint8_t i;
+	for(i=0;i<=term_npar;i++){
+		switch(term_par[i]){
+		case 0:
+			term_attr = ATTRIB_NORMAL;
+			break;
+		case 5:
+			term_attr |= ATTRIB_BLINK;
+			break;
+		case 25:
+			term_attr &= ~ATTRIB_BLINK;
+			break;
+		case 7:
+			term_attr = (term_attr & ATTRIB_BLINK) | ATTRIB_REVERSE;
+			break;
+		case 8:
+			term_attr = (term_attr & ATTRIB_BLINK) | ATTRIB_INHIBIT;
+			break;
+		case 27:
+		case 28:
+			term_attr &= ATTRIB_BLINK;
+			break;
+		}
+	}
+}
+
+static void
+term_csi(uint8_t c){
+	uint8_t n = term_par[0] ? term_par[0] : 1, y;
+
+	if(c == 'm'){ /* the only one that keeps a pending wrap */
+		term_sgr();
+		return;
+	}
+	if(term_x == COLS)
+		term_x = COLS - 1;
+
+	switch(c){
+	case 'H':
+	case 'f':
+		term_y = (n < LINES ? n : LINES) - 1;
+		n = term_par[1] ? term_par[1] : 1;
+		term_x = (n < COLS ? n : COLS) - 1;
+		break;
+	case 'A':
+		term_y = n < term_y ? term_y - n : 0;
+		break;
+	case 'B':
+		term_y = n < LINES - 1 - term_y ? term_y + n : LINES - 1;
+		break;
+	case 'C':
+		term_x = n < COLS - 1 - term_x ? term_x + n : COLS - 1;
+		break;
+	case 'D':
+		term_x = n < term_x ? term_x - n : 0;
+		break;
+	case 'J':
+		for(y=0;y<LINES;y++)
+			if(term_par[0] == 2 ? y != term_y :
+			   term_par[0] == 1 ? y < term_y : y > term_y)
+				term_erase(y,0,COLS);
+		/* fall through, the cursor line */
+	case 'K':
+		if(term_par[0] == 0)
+			term_erase(term_y,term_x,COLS);
+		else if(term_par[0] == 1)
+			term_erase(term_y,0,term_x + 1);
+		else
+			term_erase(term_y,0,COLS);
+		break;
+	case 'h':
+	case 'l':
+		if(!term_private || term_par[0] != 25)
+			break;
+		term_disp = c == 'h' ? TERM_DISP | TERM_CURSOR : TERM_DISP;
+		lcd_command(CMD_MODE_DISPLAY | term_disp);
+		break;
+	}
+}
+
+static void
+term_control(uint8_t c){
+	switch(c){
+	case '\r':
+		term_x = 0;
+		break;
+	case '\n': /* with CR, there's no stty onlcr on the way */
+	case '\v':
+	case '\f':
+		term_x = 0;
+		term_lf();
+		break;
+	case '\b':
+		if(term_x == COLS)
+			term_x--;
+		if(term_x)
+			term_x--;
+		break;
+	case '\t':
+		term_x = (term_x | (TAB - 1)) + 1;
+		if(term_x > COLS - 1)
+			term_x = COLS - 1;
+		break;
+	}
+}
+
+/* ---------- interface ---------- */
+
+void
+term_start(){
+	scroll(SCROLL_GRAPHICS | SCROLL_OFF,0);
+	scroll(SCROLL_TEXT | SCROLL_OFF,0);
+	page_end(SCROLL_GRAPHICS);
+	page_end(SCROLL_TEXT);
+	/* text area and the attributes right behind it, in one go */
+	lcd_fill(LCD_TEXT_BASE,LCD_TEXT_SIZE + LCD_TEXT_SIZE,0);
+	lcd_command(CMD_SET_MODE | CMD_MODE_TEXT_ATTRIB);
+	term_disp = TERM_DISP | TERM_CURSOR;
+	lcd_command(CMD_MODE_DISPLAY | term_disp);
+
+	term_state = term_text;
+	term_x = term_y = 0;
+	term_attr = ATTRIB_NORMAL;
+	term_attr_lines = 0;
+	term_save_x = term_save_y = 0;
+	term_save_attr = ATTRIB_NORMAL;
+	term_span_n = 0;
+	term_moved = 1;
+}
+
+static void
+term_stop(){
+	term_flush();
+	scroll(SCROLL_TEXT | SCROLL_OFF,0);
+	scroll_plane(SCROLL_ATTRIB,SCROLL_OFF,0);
+	lcd_fill(LCD_GRAPHIC_BASE,LCD_GRAPHIC_SIZE,0);
+	lcd_command(CMD_SET_MODE | CMD_MODE_OR); /* as after setup */
+	lcd_command(CMD_MODE_DISPLAY | TERM_DISP | TERM_CURSOR);
+	term_moved = 0;
+}
+
+uint8_t
+term_char(uint8_t c){
+	uint16_t v;
+
+	if(c == CHAR_TERMINAL){
+		term_stop();
+		return 1;
+	}
+	term_moved = 1;
+	if(c < 0x20 || c == 0x7f || term_state != term_text)
+		term_flush(); /* only a printable char adds to the span */
+
+	if(c < 0x20){ /* in escapes, too */
+		if(c == CHAR_ESC)
+			term_state = term_escape;
+		else if(c == CHAR_CAN || c == CHAR_SUB)
+			term_state = term_text;
+		else
+			term_control(c);
+		return 0;
+	}
+
+	switch(term_state){
+	case term_escape:
+		term_state = term_text;
+		switch(c){
+		case '[':
+			term_par[0] = term_par[1] = term_par[2] = term_par[3] = 0;
+			term_npar = 0;
+			term_private = 0;
+			term_state = term_params;
+			break;
+		case '7':
+			term_save_x = term_x;
+			term_save_y = term_y;
+			term_save_attr = term_attr;
+			break;
+		case '8':
+			term_x = term_save_x;
+			term_y = term_save_y;
+			term_attr = term_save_attr;
+			break;
+		case 'E':
+			term_x = 0;
+			/* fall through */
+		case 'D':
+			term_lf();
+			break;
+		case 'M':
+			term_ri();
+			break;
+		case 'c':
+			term_clear();
+			break;
+		}
+		break;
+
+	case term_params:
+		if(c >= '0' && c <= '9'){
+			v = term_par[term_npar] * 10 + (c - '0');
+			term_par[term_npar] = v > 0xff ? 0xff : v;
+		} else if(c == ';'){
+			if(term_npar < NPAR - 1)
+				term_npar++;
+		} else if(c == '?')
+			term_private = 1;
+		else if(c >= 0x40 && c <= 0x7e){ /* final byte */
+			term_state = term_text;
+			term_csi(c);
+		}
+		break;
+
+	default:
+		if(c != 0x7f) /* DEL */
+			term_print(c);
+		break;
+	}
+	return 0;
+}
+
+void
+term_idle(){
+	if(!term_moved)
+		return;
+	term_moved = 0;
+	term_flush();
+	lcd_command_2(CMD_CURSOR_POS,term_x < COLS ? term_x : COLS - 1,term_y);
+}
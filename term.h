@@ -0,0 +1,44 @@
+#ifndef TERM_H
+#define TERM_H
+
+#include <stdint.h>
+
+/* Terminal mode (^Y, protocol.h): a 40x8 VT100 subset for tailing logs.
+   Printable chars go to the cursor and wrap at the right edge, a line
+   feed on the bottom line scrolls the text area by moving its home
+   address (scroll.c). The graphics plane holds text attributes
+   meanwhile (CMD_MODE_TEXT_ATTRIB), for inverse and blinking text.
+
+   Control chars: CR, LF (also VT, FF, implies CR), BS, TAB (every 8
+   columns), ^Y leaves; everything else is ignored. Escapes:
+	ESC [ row ; col H   cursor position, 1 based (also f)
+	ESC [ n A/B/C/D     cursor up/down/right/left
+	ESC [ n J           erase screen, 0: from the cursor, 1: up to it,
+	                    2: all
+	ESC [ n K           erase line, the same
+	ESC [ n;.. m        0 normal, 7/27 inverse on/off, 5/25 blink on/off,
+	                    8/28 hidden on/off
+	ESC [ ?25 h/l       cursor on/off
+	ESC 7, ESC 8        save/restore cursor
+	ESC D, ESC M        index, reverse index (scroll down on top)
+	ESC c               reset: clear, cursor home, attributes off */
+
+/* build with -DTERM_BOOT=1 to start up in terminal mode instead of
+   showing the splash, so the display is a plain serial terminal */
+#ifndef TERM_BOOT
+#define TERM_BOOT 0
+#endif
+
+/* enter: ends scrolling and double buffering of both planes, clears
+   them, cursor home */
+extern void term_start();
+
+/* eat one byte in terminal mode; nonzero: it was ^Y, terminal mode is
+   left, the text stays and the graphics plane is cleared */
+extern uint8_t term_char(uint8_t c);
+
+/* no input for a while (main_idle() in everavr.c): write the pending
+   text, move the hardware cursor where it belongs */
+extern void term_idle();
+
+#endif
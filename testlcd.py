@@ -31,33 +31,29 @@ if len(data) != size[0]*size[1] :
 	raise RuntimeError('Too little or too much data read; want %d, got %d.'%(\
 		size[0]*size[1],len(data)))
 
-import serial
 import sys
-import time
+import everavr
 
-#S = serial.Serial('/dev/ttyUSB0',115200)
-
-f = open('/dev/hidraw3','w')
-f.write(chr(0x00)+chr(0x05)) # report-no 0 (ignored), 0x05 -> reset
-time.sleep(0.5)    # wait for reset to complete
+# /dev/hidrawN or a serial port; either way the firmware's flow control
+# (NAK on USB, RTS on serial) paces us, no need to sleep
+if len(sys.argv) > 1 :
+	dev = everavr.Device(sys.argv[1])
+else :
+	dev = everavr.Device('/dev/hidraw3')
 
+# the firmware queues everything, no need to wait for the reset to finish
 buf=list()
 buf.append(chr(0x05)) # reset
 buf.append(chr(0x07)+chr(0x0f)) # display to graphics+text+cursor+blink mode
 buf.append(chr(0x06)+chr(0x01)) # text+graphics XOR mode
+buf.append(chr(0x18)+chr(0x01)) # draw into the hidden page (^X PAGE_BACK)
 buf.append(chr(0x03)+chr(0x40)+chr(0x01)) # set write pointer to 0x0140
 
-for y in range(60) :
-	lcddata = ''
-	for x in range(0,240,6) :
-		d = 0
-		for c in range(6) :
-			if data[x+y*240+c] == '0' :
-				d |= 1<<(5-c)
-		lcddata = lcddata + chr(d)
-		#buf.append(chr(0x01)+chr(d)) # write char
-#	print 'Bulk xfer of %d bytes.'%(len(lcddata))
-	buf.append(chr(0x09)+chr(len(lcddata))+lcddata) # bulk transfer
+rows = [ [ data[x+y*240] == '0' for x in range(240) ] for y in range(60) ]
+lcddata = everavr.pack_pixels(rows)
+# the whole picture in one bulk transfer, packed (^L) if that's shorter
+buf.append(everavr.cmd_write_best(lcddata))
+buf.append(chr(0x18)+chr(0x02)) # show it in one go (^X PAGE_FLIP)
 
 buf.append(chr(0x03)+chr(0)+chr(0x00)) # set write offset
 buf.append('Hello.')
@@ -66,6 +62,5 @@ buf.append(chr(0x10)+chr(27)+chr(2)) # cursor pos 27:2
 buf.append(chr(0x03)+chr(97)+chr(0x00)) # set write offset
 buf.append('Text_Layer.')
 
-for x in buf :
-	f.write(chr(0x00) + x)
+dev.write(''.join(buf))
 